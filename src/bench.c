@@ -0,0 +1,316 @@
+#include "bench.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "defs.h"
+
+#define BENCH_PATHS 4
+#define BENCH_TELEPORT_EVERY 60 /* frames between jumps */
+#define BENCH_TELEPORT_RANGE 1984.0f /* keeps a view inside a --genworld world */
+
+typedef struct _bench_path {
+	const char* name;
+	float x, y; /* starting position */
+} bench_path;
+
+typedef struct _bench_run {
+	const bench_path* path;
+	float* ms;
+	unsigned* compiles;
+	int frames;
+	double phase_cpu[BENCH_PHASES], phase_gpu[BENCH_PHASES];
+	unsigned phase_n[BENCH_PHASES];
+} bench_run;
+
+static const bench_path paths[BENCH_PATHS] = {
+	{ "pan", 64.0f, 64.0f },
+	{ "diagonal", 64.0f, 64.0f },
+	{ "teleport", 64.0f, 64.0f },
+	{ "jitter", 100.0f, 64.0f },
+};
+
+static bench_run runs[BENCH_PATHS];
+static int nruns, cur, frame, per_path, warmup, active;
+static unsigned frame_compiles, teleport_seed;
+static const char* phase_names[BENCH_PHASES];
+
+static float bench_percentile(const float* sorted, int n, float p);
+static int bench_cmp(const void* a, const void* b);
+static int bench_baseline_value(const char* base, const char* path, const char* key, double* out);
+
+int bench_init(const char* list, int frames) {
+	char* names = strdup(list);
+	char* save = NULL;
+
+	if (!names) return 1;
+
+	per_path = frames > 0 ? frames : BENCH_FRAMES;
+
+	for (char* n = strtok_r(names, ",", &save); n; n = strtok_r(NULL, ",", &save)) {
+		for (int i = 0; i < BENCH_PATHS; ++i) {
+			if (strcmp(n, "all") && strcmp(n, paths[i].name)) continue;
+			if (nruns == BENCH_PATHS) break;
+
+			runs[nruns].path = paths + i;
+			runs[nruns].ms = malloc(sizeof(float) * per_path);
+			runs[nruns].compiles = malloc(sizeof(unsigned) * per_path);
+			if (!runs[nruns].ms || !runs[nruns].compiles) {
+				free(runs[nruns].ms);
+				free(runs[nruns].compiles);
+				free(names);
+				return 1;
+			}
+
+			nruns++;
+		}
+	}
+
+	free(names);
+
+	if (!nruns) {
+		printf("bench: no paths matched %s (pan, diagonal, teleport, jitter, all)\n", list);
+		return 1;
+	}
+
+	active = 1;
+	warmup = BENCH_WARMUP;
+	teleport_seed = 1;
+
+	printf("bench: %d paths, %d frames each\n", nruns, per_path);
+	return 0;
+}
+
+void bench_free(void) {
+	for (int i = 0; i < nruns; ++i) {
+		free(runs[i].ms);
+		free(runs[i].compiles);
+	}
+
+	nruns = cur = frame = active = 0;
+}
+
+int bench_active(void) {
+	return active;
+}
+
+int bench_done(void) {
+	return cur == nruns;
+}
+
+void bench_camera(float* x, float* y, float* vx, float* vy) {
+	if (cur == nruns) return;
+
+	const bench_path* p = runs[cur].path;
+	float t = frame;
+
+	/* warmup sits at the first path's start */
+	if (warmup || !frame) {
+		*x = p->x;
+		*y = p->y;
+		*vx = *vy = 0.0f;
+		return;
+	}
+
+	if (!strcmp(p->name, "pan")) {
+		*vx = 0.2f;
+		*vy = 0.0f;
+	} else if (!strcmp(p->name, "diagonal")) {
+		*vx = *vy = 0.8f; /* HMAX, VMAX */
+	} else if (!strcmp(p->name, "teleport")) {
+		*vx = *vy = 0.0f;
+
+		if (!(frame % BENCH_TELEPORT_EVERY)) {
+			/* fixed seed so every run jumps to the same places */
+			*x = rand_r(&teleport_seed) / (float) RAND_MAX * BENCH_TELEPORT_RANGE;
+			*y = rand_r(&teleport_seed) / (float) RAND_MAX * BENCH_TELEPORT_RANGE;
+			return;
+		}
+	} else {
+		/* swings across a chunk edge and back every 40 frames */
+		*vx = 0.8f * cosf(t * (float) M_PI / 20.0f);
+		*vy = 0.0f;
+	}
+
+	*x += *vx;
+	*y += *vy;
+}
+
+void bench_compiles(unsigned n) {
+	frame_compiles += n;
+}
+
+void bench_phase(int phase, const char* name, float cpu_ms, float gpu_ms) {
+	if (!active || warmup || cur == nruns || phase < 0 || phase >= BENCH_PHASES) return;
+
+	/* gpu results arrive a few frames late, near a path boundary they count toward the next path */
+	phase_names[phase] = name;
+	runs[cur].phase_cpu[phase] += cpu_ms;
+	runs[cur].phase_gpu[phase] += gpu_ms;
+	runs[cur].phase_n[phase]++;
+}
+
+void bench_frame(float ms) {
+	if (!active) return;
+
+	if (warmup) {
+		warmup--;
+	} else if (cur < nruns) {
+		runs[cur].ms[frame] = ms;
+		runs[cur].compiles[frame] = frame_compiles;
+		runs[cur].frames = ++frame;
+
+		if (frame == per_path) {
+			cur++;
+			frame = 0;
+		}
+	}
+
+	frame_compiles = 0;
+}
+
+int bench_report(const char* demo, const char* out, const char* baseline, float tolerance) {
+	FILE* f = out ? fopen(out, "w") : stdout;
+	if (!f) {
+		printf("bench: can't write %s\n", out);
+		return 1;
+	}
+
+	char* base = NULL;
+
+	if (baseline) {
+		FILE* bf = fopen(baseline, "r");
+
+		if (bf) {
+			fseek(bf, 0, SEEK_END);
+			long len = ftell(bf);
+			fseek(bf, 0, SEEK_SET);
+
+			base = calloc(len + 1, 1);
+			if (base && fread(base, 1, len, bf) != (size_t) len) {
+				free(base);
+				base = NULL;
+			}
+
+			fclose(bf);
+		}
+
+		if (!base) {
+			printf("bench: can't read baseline %s\n", baseline);
+			if (out) fclose(f);
+			return 1;
+		}
+	}
+
+	int regressed = 0;
+
+	fprintf(f, "{\n\t\"demo\": \"%s\",\n\t\"chunksize\": %d,\n\t\"frames_per_path\": %d,\n\t\"paths\": [\n", demo, CHUNKSIZE, per_path);
+
+	for (int i = 0; i < nruns; ++i) {
+		bench_run* r = runs + i;
+		float* sorted = malloc(sizeof(float) * (r->frames ? r->frames : 1));
+		double total_ms = 0.0;
+		unsigned compiles = 0, worst = 0;
+
+		if (!sorted) break;
+
+		for (int j = 0; j < r->frames; ++j) {
+			sorted[j] = r->ms[j];
+			total_ms += r->ms[j];
+			compiles += r->compiles[j];
+			if (r->compiles[j] > worst) worst = r->compiles[j];
+		}
+
+		qsort(sorted, r->frames, sizeof *sorted, bench_cmp);
+
+		double v[6] = {
+			r->frames ? total_ms / r->frames : 0.0,
+			bench_percentile(sorted, r->frames, 50.0f),
+			bench_percentile(sorted, r->frames, 95.0f),
+			bench_percentile(sorted, r->frames, 99.0f),
+			r->frames ? sorted[r->frames - 1] : 0.0,
+			total_ms > 0.0 ? compiles / (total_ms / 1000.0) : 0.0,
+		};
+
+		fprintf(f, "\t\t{\n\t\t\t\"name\": \"%s\",\n\t\t\t\"frames\": %d,\n", r->path->name, r->frames);
+		fprintf(f, "\t\t\t\"ms_mean\": %.4f,\n\t\t\t\"ms_p50\": %.4f,\n\t\t\t\"ms_p95\": %.4f,\n\t\t\t\"ms_p99\": %.4f,\n\t\t\t\"ms_max\": %.4f,\n", v[0], v[1], v[2], v[3], v[4]);
+		fprintf(f, "\t\t\t\"compiles\": %u,\n\t\t\t\"compiles_per_sec\": %.2f,\n\t\t\t\"worst_frame_compiles\": %u", compiles, v[5], worst);
+
+		/* kept last, the baseline reader stops at the first closing brace after the name */
+		int first = 1;
+		for (int p = 0; p < BENCH_PHASES; ++p) {
+			if (!r->phase_n[p]) continue;
+
+			fprintf(f, "%s\t\t\t\t\"%s\": { \"cpu_ms\": %.4f, \"gpu_ms\": %.4f }", first ? ",\n\t\t\t\"phases\": {\n" : ",\n", phase_names[p], r->phase_cpu[p] / r->phase_n[p], r->phase_gpu[p] / r->phase_n[p]);
+			first = 0;
+		}
+
+		fprintf(f, "%s\n\t\t}%s\n", first ? "" : "\n\t\t\t}", i + 1 < nruns ? "," : "");
+
+		free(sorted);
+
+		if (!base) continue;
+
+		/* frame times must not grow and compile throughput must not drop by more than the tolerance */
+		static const char* keys[] = { "ms_mean", "ms_p95", "ms_p99", "compiles_per_sec" };
+		const double cur_v[] = { v[0], v[2], v[3], v[5] };
+
+		for (int k = 0; k < 4; ++k) {
+			double b;
+			if (bench_baseline_value(base, r->path->name, keys[k], &b)) {
+				printf("bench: %s.%s missing from baseline, skipped\n", r->path->name, keys[k]);
+				continue;
+			}
+
+			int lower_better = k < 3;
+			double limit = lower_better ? b * (1.0 + tolerance / 100.0) : b * (1.0 - tolerance / 100.0);
+			int bad = lower_better ? cur_v[k] > limit : cur_v[k] < limit;
+
+			printf("bench: %-9s %-17s %10.3f baseline %10.3f %s\n", r->path->name, keys[k], cur_v[k], b, bad ? "REGRESSED" : "ok");
+			regressed |= bad;
+		}
+	}
+
+	fprintf(f, "\t]\n}\n");
+
+	if (out) fclose(f);
+	free(base);
+
+	if (regressed) printf("bench: regressed against %s (tolerance %.1f%%)\n", baseline, tolerance);
+	return regressed;
+}
+
+float bench_percentile(const float* sorted, int n, float p) {
+	if (!n) return 0.0f;
+
+	/* nearest rank */
+	int i = (int) ceilf(p / 100.0f * n) - 1;
+	if (i < 0) i = 0;
+	if (i >= n) i = n - 1;
+	return sorted[i];
+}
+
+int bench_cmp(const void* a, const void* b) {
+	float fa = *(const float*) a, fb = *(const float*) b;
+	return fa < fb ? -1 : fa > fb;
+}
+
+int bench_baseline_value(const char* base, const char* path, const char* key, double* out) {
+	/* just enough JSON to read back our own reports: find the path's object, then the key inside it */
+	char tag[64];
+	snprintf(tag, sizeof tag, "\"name\": \"%s\"", path);
+
+	const char* obj = strstr(base, tag);
+	if (!obj) return 1;
+
+	const char* end = strchr(obj, '}');
+	snprintf(tag, sizeof tag, "\"%s\":", key);
+
+	const char* v = strstr(obj, tag);
+	if (!v || (end && v > end)) return 1;
+
+	*out = strtod(v + strlen(tag), NULL);
+	return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+/*
+ * bench
+ *
+ * scripted camera paths for repeatable performance runs. while a bench is active it drives
+ * the camera instead of the keyboard, records every frame's time and chunk compile count,
+ * and at the end writes a JSON report that can be checked against a saved baseline.
+ *
+ * paths: pan (slow pan), diagonal (max speed diagonal), teleport (random jumps), jitter (back and forth over a chunk edge)
+ */
+
+#define BENCH_FRAMES 600 /* default frames per path */
+#define BENCH_WARMUP 60 /* unrecorded frames before the first path, covers demo init */
+#define BENCH_TOLERANCE 10.0f /* default allowed regression against a baseline, percent */
+#define BENCH_PHASES 8 /* max distinct phases passed to bench_phase */
+
+int bench_init(const char* paths, int frames); /* comma separated path names or "all" */
+void bench_free(void);
+int bench_active(void);
+
+void bench_camera(float* x, float* y, float* vx, float* vy); /* move the camera for this frame */
+int bench_done(void); /* nonzero once every path has run */
+void bench_compiles(unsigned n); /* chunks compiled (or uploaded) this frame, called by the demo */
+void bench_frame(float ms); /* closes the frame */
+void bench_phase(int phase, const char* name, float cpu_ms, float gpu_ms); /* one timed render phase, averaged per path */
+
+/* writes the report to out (stdout if NULL), nonzero if any path regressed against baseline (if not NULL) */
+int bench_report(const char* demo, const char* out, const char* baseline, float tolerance);
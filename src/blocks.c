@@ -0,0 +1,135 @@
+#include "blocks.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+
+#include <GLXW/glxw.h>
+
+#include "stb_image.h"
+
+static const char* blocks_builtin[] = {
+	"res/grass.png",
+	"res/stone.png",
+	"res/brick.png"
+};
+
+static int blocks_cmp(const void* a, const void* b);
+static int blocks_add(blocks* b, const char* filename, unsigned char** pixels);
+
+int blocks_load(blocks* b, const char* dir, int size) {
+	unsigned char* pixels[BLOCKS_MAX] = {0};
+
+	memset(b, 0, sizeof *b);
+	b->size = size;
+	b->count = 1; /* layer 0 is the empty block */
+
+	for (unsigned i = 0; i < sizeof blocks_builtin / sizeof *blocks_builtin; ++i) {
+		blocks_add(b, blocks_builtin[i], pixels);
+	}
+
+	if (dir) {
+		DIR* d = opendir(dir);
+		if (!d) {
+			printf("blocks: can't open %s\n", dir);
+		} else {
+			char* found[BLOCKS_MAX];
+			int nfound = 0;
+			struct dirent* e;
+
+			while ((e = readdir(d)) && nfound < BLOCKS_MAX) {
+				size_t len = strlen(e->d_name);
+				if (len < 5 || strcmp(e->d_name + len - 4, ".png")) continue;
+
+				found[nfound] = malloc(strlen(dir) + len + 2);
+				sprintf(found[nfound++], "%s/%s", dir, e->d_name);
+			}
+
+			closedir(d);
+
+			/* sort so block ids stay stable between runs */
+			qsort(found, nfound, sizeof *found, blocks_cmp);
+
+			for (int i = 0; i < nfound; ++i) {
+				blocks_add(b, found[i], pixels);
+				free(found[i]);
+			}
+		}
+	}
+
+	unsigned char* black = calloc(size * size, 4);
+	for (int i = 0; i < size * size; ++i) black[i * 4 + 3] = 255;
+
+	glGenTextures(1, &b->tex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, b->tex);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, b->count, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, black);
+
+	for (int i = 1; i < b->count; ++i) {
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels[i]);
+		free(pixels[i]);
+	}
+
+	free(black);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	printf("blocks: packed %d block types into a %dx%dx%d array\n", b->count - 1, size, size, b->count);
+	return b->count < 2;
+}
+
+void blocks_free(blocks* b) {
+	glDeleteTextures(1, &b->tex);
+	for (int i = 0; i < b->count; ++i) free(b->names[i]);
+	memset(b, 0, sizeof *b);
+}
+
+unsigned char* blocks_load_image(const char* filename, int* w, int* h) {
+	unsigned char* stbd = stbi_load(filename, w, h, NULL, 4);
+	if (!stbd) {
+		printf("tex fail: %s\n", filename);
+		return NULL;
+	}
+
+	unsigned char* next = malloc(*w * *h * 4);
+	int rw = 4 * *w;
+	for (int j = 0; j < *h; ++j) {
+		memcpy(next + j * rw, stbd + (*h-1) * rw - j*rw, rw);
+	}
+
+	stbi_image_free(stbd);
+	return next;
+}
+
+int blocks_add(blocks* b, const char* filename, unsigned char** pixels) {
+	if (b->count == BLOCKS_MAX) {
+		printf("blocks: out of block ids, skipping %s\n", filename);
+		return 1;
+	}
+
+	for (int i = 1; i < b->count; ++i) {
+		if (!strcmp(b->names[i], filename)) return 0;
+	}
+
+	int w, h;
+	unsigned char* next = blocks_load_image(filename, &w, &h);
+	if (!next) return 1;
+
+	if (w != b->size || h != b->size) {
+		printf("blocks: skipping %s, %dx%d instead of %dx%d\n", filename, w, h, b->size, b->size);
+		free(next);
+		return 1;
+	}
+
+	pixels[b->count] = next;
+	b->names[b->count++] = strdup(filename);
+	return 0;
+}
+
+int blocks_cmp(const void* a, const void* b) {
+	return strcmp(*(char* const*) a, *(char* const*) b);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+/*
+ * blocks
+ *
+ * packs every block texture into one GL_TEXTURE_2D_ARRAY so any tile can be drawn
+ * by layer index without touching texture bindings.
+ * layer 0 is the empty block (opaque black), layer n is the nth loaded image.
+ */
+
+#define BLOCKS_MAX 256 /* layers in the bank, tile ids past the last layer draw as the last layer */
+
+typedef struct _blocks {
+	unsigned tex; /* GL_TEXTURE_2D_ARRAY */
+	int count, size; /* layers, pixels per side */
+	char* names[BLOCKS_MAX];
+} blocks;
+
+/*
+ * loads the builtin block types, then every .png in dir (if not NULL) in name order.
+ * size: required width and height of each image, mismatches are skipped with a warning
+ */
+int blocks_load(blocks* b, const char* dir, int size);
+void blocks_free(blocks* b);
+
+unsigned char* blocks_load_image(const char* filename, int* w, int* h); /* RGBA rows flipped for GL, free() the result */
@@ -0,0 +1,21 @@
+#pragma once
+
+/*
+ * camera
+ *
+ * layout of the camera uniform block, kept out of tileproto.h so modules with their own
+ * GL helpers (text) can include it. camera_upload rewrites the block once per frame
+ */
+
+#define CAMERA_BINDING 0 /* uniform buffer binding of the camera block */
+
+/*
+ * per-frame camera state shared by every shader. paste it in after the #version line,
+ * link_program binds it for any program that uses it
+ */
+#define CAMERA_BLOCK "layout(std140) uniform camera {\n" \
+			"	mat4 viewproj;\n" /* tiles to clip space */ \
+			"	mat4 screen;\n" /* pixels from the lower left to clip space */ \
+			"	vec4 view;\n" /* x, y, width, height of the view in tiles */ \
+			"	vec2 viewport;\n" /* pixels */ \
+			"};\n"
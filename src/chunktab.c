@@ -0,0 +1,203 @@
+#include "chunktab.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "timer.h"
+
+#define SLOT_EMPTY 0
+#define SLOT_LIVE 1
+#define SLOT_DEAD 2
+
+static uint64_t chunktab_key(int cx, int cy);
+static uint64_t chunktab_hash(uint64_t k);
+static int chunktab_resize(chunktab* t, unsigned cap);
+
+int chunktab_init(chunktab* t, unsigned cap) {
+	unsigned c = 16;
+	while (c < cap) c <<= 1;
+
+	memset(t, 0, sizeof *t);
+	return chunktab_resize(t, c);
+}
+
+void chunktab_free(chunktab* t) {
+	free(t->keys);
+	free(t->state);
+	free(t->vals);
+	memset(t, 0, sizeof *t);
+}
+
+live_chunk* chunktab_find(chunktab* t, int cx, int cy) {
+	uint64_t k = chunktab_key(cx, cy);
+	unsigned mask = t->cap - 1;
+
+	for (unsigned i = chunktab_hash(k) & mask;; i = (i + 1) & mask) {
+		if (t->state[i] == SLOT_EMPTY) return NULL;
+		if (t->state[i] == SLOT_LIVE && t->keys[i] == k) return t->vals + i;
+	}
+}
+
+live_chunk* chunktab_insert(chunktab* t, int cx, int cy) {
+	live_chunk* c = chunktab_find(t, cx, cy);
+	if (c) return c;
+
+	/* keep the probe chains short: grow when mostly live, otherwise just sweep tombstones */
+	if ((t->used + 1) * 4 > t->cap * 3) {
+		if (chunktab_resize(t, (t->count + 1) * 2 > t->cap ? t->cap * 2 : t->cap)) return NULL;
+	}
+
+	uint64_t k = chunktab_key(cx, cy);
+	unsigned mask = t->cap - 1, i = chunktab_hash(k) & mask;
+
+	while (t->state[i] == SLOT_LIVE) i = (i + 1) & mask;
+
+	if (t->state[i] == SLOT_EMPTY) t->used++;
+	t->count++;
+	t->state[i] = SLOT_LIVE;
+	t->keys[i] = k;
+
+	c = t->vals + i;
+	memset(c, 0, sizeof *c);
+	c->cx = cx;
+	c->cy = cy;
+	return c;
+}
+
+void chunktab_erase(chunktab* t, live_chunk* c) {
+	unsigned i = c - t->vals;
+	if (i >= t->cap || t->state[i] != SLOT_LIVE) return;
+
+	t->state[i] = SLOT_DEAD;
+	t->count--;
+}
+
+live_chunk* chunktab_next(chunktab* t, unsigned* it) {
+	while (*it < t->cap) {
+		unsigned i = (*it)++;
+		if (t->state[i] == SLOT_LIVE) return t->vals + i;
+	}
+	return NULL;
+}
+
+uint64_t chunktab_key(int cx, int cy) {
+	return ((uint64_t) (uint32_t) cx << 32) | (uint32_t) cy;
+}
+
+uint64_t chunktab_hash(uint64_t k) {
+	/* murmur3 finalizer, neighbouring chunks differ only in the low bits of each half */
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+int chunktab_resize(chunktab* t, unsigned cap) {
+	chunktab next = {0};
+
+	next.keys = malloc(sizeof *next.keys * cap);
+	next.state = calloc(cap, sizeof *next.state);
+	next.vals = malloc(sizeof *next.vals * cap);
+	next.cap = cap;
+
+	if (!next.keys || !next.state || !next.vals) {
+		printf("chunktab: failed to allocate %u slots\n", cap);
+		chunktab_free(&next);
+		return 1;
+	}
+
+	for (unsigned i = 0; i < t->cap; ++i) {
+		if (t->state[i] != SLOT_LIVE) continue;
+
+		unsigned j = chunktab_hash(t->keys[i]) & (cap - 1);
+		while (next.state[j] != SLOT_EMPTY) j = (j + 1) & (cap - 1);
+
+		next.state[j] = SLOT_LIVE;
+		next.keys[j] = t->keys[i];
+		next.vals[j] = t->vals[i];
+		next.count++;
+	}
+
+	next.used = next.count;
+	chunktab_free(t);
+	*t = next;
+	return 0;
+}
+
+typedef struct _bench_node {
+	int cx, cy;
+	struct _bench_node* next;
+} bench_node;
+
+int chunktab_bench(void) {
+	/*
+	 * compare the hash table against the old live_chunk list walk.
+	 * chunks are loaded as a square block around the origin and half of the lookups miss,
+	 * which is roughly what the render loop sees when the camera crosses a boundary.
+	 */
+
+	static const int sizes[] = { 100, 1000, 10000 };
+	volatile unsigned sink = 0;
+
+	printf("chunktab: lookup microbenchmark (ns per lookup)\n");
+	printf("%8s %12s %12s %10s\n", "loaded", "list", "chunktab", "speedup");
+
+	for (unsigned s = 0; s < sizeof sizes / sizeof *sizes; ++s) {
+		int n = sizes[s], side = 1;
+		while (side * side < n) ++side;
+
+		chunktab t;
+		bench_node* nodes = malloc(sizeof *nodes * n), *head = NULL;
+		if (chunktab_init(&t, 16) || !nodes) return 1;
+
+		for (int i = 0; i < n; ++i) {
+			nodes[i].cx = i % side;
+			nodes[i].cy = i / side;
+			nodes[i].next = head;
+			head = nodes + i;
+			chunktab_insert(&t, nodes[i].cx, nodes[i].cy);
+		}
+
+		int lookups = 20000000 / n;
+		if (lookups < 1000) lookups = 1000;
+
+		srand(1);
+		int* qx = malloc(sizeof *qx * lookups), *qy = malloc(sizeof *qy * lookups);
+		for (int i = 0; i < lookups; ++i) {
+			qx[i] = rand() % (side * 2);
+			qy[i] = rand() % side;
+		}
+
+		tp start = timer_get();
+		for (int i = 0; i < lookups; ++i) {
+			for (bench_node* c = head; c; c = c->next) {
+				if (c->cx == qx[i] && c->cy == qy[i]) {
+					sink++;
+					break;
+				}
+			}
+		}
+		float list_ns = timer_diff(start) * 1000000.0f / lookups;
+
+		start = timer_get();
+		for (int k = 0; k < 1000000 / lookups + 1; ++k) {
+			for (int i = 0; i < lookups; ++i) {
+				if (chunktab_find(&t, qx[i], qy[i])) sink++;
+			}
+		}
+		float tab_ns = timer_diff(start) * 1000000.0f / (lookups * (1000000 / lookups + 1));
+
+		printf("%8d %12.1f %12.1f %9.1fx\n", n, list_ns, tab_ns, list_ns / tab_ns);
+
+		free(qx);
+		free(qy);
+		free(nodes);
+		chunktab_free(&t);
+	}
+
+	(void) sink;
+	return 0;
+}
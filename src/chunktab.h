@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+
+#include "texpool.h"
+
+/*
+ * chunktab
+ *
+ * open-addressing hash table of live chunks keyed by packed (cx, cy).
+ * the table owns the chunk records and stores them inline, so a pointer
+ * returned by find/insert is only valid until the next insert (which may rehash).
+ * erase leaves a tombstone, so erasing while iterating is safe.
+ */
+
+#define CHUNK_LOADING 0 /* tile data is being prepared by a worker, drawn as a placeholder */
+#define CHUNK_QUEUED 1 /* tile data ready and waiting in the compile queue, also a placeholder */
+#define CHUNK_READY 2 /* compiled, target is valid */
+
+typedef struct _live_chunk {
+	int cx, cy, state;
+	unsigned gen; /* request the record waits on, jobs from older requests read tiles it may not have seen edited */
+	texpool_target target;
+	int dirty[4]; /* tiles edited since the compile, x0, y0, x1, y1. patched once ready, empty when x1 is 0 */
+	int stale; /* super-chunks only, instead of dirty: a tile under it was edited since the bake */
+	unsigned last_used, last_visible; /* frame numbers, for the residency policy */
+} live_chunk;
+
+typedef struct _chunktab {
+	uint64_t* keys;
+	uint8_t* state;
+	live_chunk* vals;
+	unsigned cap, count, used; /* used = live + tombstones */
+} chunktab;
+
+int chunktab_init(chunktab* t, unsigned cap); /* cap is rounded up to a power of two */
+void chunktab_free(chunktab* t);
+
+live_chunk* chunktab_find(chunktab* t, int cx, int cy);
+live_chunk* chunktab_insert(chunktab* t, int cx, int cy); /* returns the existing record if present, otherwise a zeroed one */
+void chunktab_erase(chunktab* t, live_chunk* c);
+
+/* iterate with: unsigned it = 0; while ((c = chunktab_next(t, &it))) { ... } */
+live_chunk* chunktab_next(chunktab* t, unsigned* it);
+
+int chunktab_bench(void); /* lookup microbenchmark against a linked list */
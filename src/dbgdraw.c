@@ -0,0 +1,193 @@
+#include "dbgdraw.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#include <GLXW/glxw.h>
+
+#include "tileproto.h"
+
+typedef struct _dbgdraw_vert {
+	float x, y;
+	unsigned char col[4];
+} dbgdraw_vert;
+
+static dbgdraw_vert queue[DBGDRAW_VERTS];
+static unsigned queue_len, flushed, last_lines;
+
+static unsigned line_vao, line_vbo, line_prg;
+static unsigned grid_vao, grid_prg, loc_grid_spacing, loc_grid_width, loc_grid_col;
+
+static int segment, enabled;
+
+static const char* dbgdraw_line_vs = "#version 330\n"
+			CAMERA_BLOCK
+			"layout(location = 0) in vec2 pos;\n"
+			"layout(location = 1) in vec4 vcol;\n"
+			"out vec4 col;\n"
+			"void main(void) {\n"
+			"	gl_Position = viewproj * vec4(pos, 0.0, 1.0);\n"
+			"	col = vcol;\n"
+			"}\n";
+
+static const char* dbgdraw_line_fs = "#version 330\n"
+			"in vec4 col;\n"
+			"out vec4 color;\n"
+			"void main(void) {\n"
+			"	color = col;\n"
+			"}\n";
+
+/* fullscreen triangle, the fragment finds its world position and its pixel distance to the nearest line */
+static const char* dbgdraw_grid_vs = "#version 330\n"
+			"void main(void) {\n"
+			"	vec2 p = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 4.0 - 1.0;\n"
+			"	gl_Position = vec4(p, 0.0, 1.0);\n"
+			"}\n";
+
+static const char* dbgdraw_grid_fs = "#version 330\n"
+			CAMERA_BLOCK
+			"uniform float spacing;\n"
+			"uniform float width;\n"
+			"uniform vec4 col;\n"
+			"out vec4 color;\n"
+			"void main(void) {\n"
+			"	vec2 scale = view.zw / viewport;\n"
+			"	vec2 world = view.xy + gl_FragCoord.xy * scale;\n"
+			"	vec2 d = abs(fract(world / spacing + 0.5) - 0.5) * spacing / scale;\n"
+			"	float a = clamp(width * 0.5 + 0.5 - min(d.x, d.y), 0.0, 1.0);\n"
+			"	if (a == 0.0) discard;\n"
+			"	color = vec4(col.rgb, col.a * a);\n"
+			"}\n";
+
+static void dbgdraw_vertex(float x, float y, const float* col);
+static void dbgdraw_submit(void);
+
+int dbgdraw_init(void) {
+	line_prg = make_program(dbgdraw_line_vs, dbgdraw_line_fs);
+	if (!line_prg) return 1;
+
+	grid_prg = make_program(dbgdraw_grid_vs, dbgdraw_grid_fs);
+	if (!grid_prg) return 1;
+
+	loc_grid_spacing = glGetUniformLocation(grid_prg, "spacing");
+	loc_grid_width = glGetUniformLocation(grid_prg, "width");
+	loc_grid_col = glGetUniformLocation(grid_prg, "col");
+
+	glGenVertexArrays(1, &line_vao);
+	glBindVertexArray(line_vao);
+	glGenBuffers(1, &line_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, line_vbo);
+
+	glBufferData(GL_ARRAY_BUFFER, sizeof queue * DBGDRAW_SEGMENTS, NULL, GL_STREAM_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(dbgdraw_vert), (void*) offsetof(dbgdraw_vert, x));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(dbgdraw_vert), (void*) offsetof(dbgdraw_vert, col));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+
+	glGenVertexArrays(1, &grid_vao);
+
+	glUseProgram(prg);
+
+	enabled = 1;
+	return 0;
+}
+
+void dbgdraw_free(void) {
+	if (!enabled) return;
+
+	glDeleteBuffers(1, &line_vbo);
+	glDeleteVertexArrays(1, &line_vao);
+	glDeleteVertexArrays(1, &grid_vao);
+	glDeleteProgram(line_prg);
+	glDeleteProgram(grid_prg);
+
+	queue_len = flushed = last_lines = 0;
+	segment = enabled = 0;
+}
+
+void dbgdraw_line(float x0, float y0, float x1, float y1, const float* col) {
+	if (queue_len + 2 > DBGDRAW_VERTS) dbgdraw_submit();
+
+	dbgdraw_vertex(x0, y0, col);
+	dbgdraw_vertex(x1, y1, col);
+}
+
+void dbgdraw_rect(float x, float y, float w, float h, const float* col) {
+	dbgdraw_line(x, y, x + w, y, col);
+	dbgdraw_line(x + w, y, x + w, y + h, col);
+	dbgdraw_line(x + w, y + h, x, y + h, col);
+	dbgdraw_line(x, y + h, x, y, col);
+}
+
+void dbgdraw_cross(float x, float y, float size, const float* col) {
+	float r = size / 2.0f;
+
+	dbgdraw_line(x - r, y - r, x + r, y + r, col);
+	dbgdraw_line(x - r, y + r, x + r, y - r, col);
+}
+
+void dbgdraw_flush(void) {
+	dbgdraw_submit();
+
+	last_lines = flushed;
+	flushed = 0;
+}
+
+unsigned dbgdraw_lines(void) {
+	return last_lines;
+}
+
+void dbgdraw_grid(float spacing, float width, const float* col) {
+	if (!enabled) return;
+
+	glUseProgram(grid_prg);
+	glUniform1f(loc_grid_spacing, spacing);
+	glUniform1f(loc_grid_width, width);
+	glUniform4fv(loc_grid_col, 1, col);
+
+	glBindVertexArray(grid_vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	glUseProgram(prg);
+}
+
+void dbgdraw_vertex(float x, float y, const float* col) {
+	dbgdraw_vert* v = queue + queue_len++;
+
+	v->x = x;
+	v->y = y;
+	for (int i = 0; i < 4; ++i) v->col[i] = col[i] * 255.0f + 0.5f;
+}
+
+void dbgdraw_submit(void) {
+	if (!enabled || !queue_len) return;
+
+	size_t offset = sizeof queue * segment, len = sizeof *queue * queue_len;
+
+	glBindVertexArray(line_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, line_vbo);
+
+	/* back at the first segment, earlier draws may still read the old storage so it's orphaned */
+	if (!segment) glBufferData(GL_ARRAY_BUFFER, sizeof queue * DBGDRAW_SEGMENTS, NULL, GL_STREAM_DRAW);
+
+	void* dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, len, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!dst) {
+		printf("dbgdraw: can't map the vertex buffer\n");
+		queue_len = 0;
+		return;
+	}
+
+	memcpy(dst, queue, len);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	glUseProgram(line_prg);
+	glDrawArrays(GL_LINES, offset / sizeof *queue, queue_len);
+	glUseProgram(prg);
+
+	segment = (segment + 1) % DBGDRAW_SEGMENTS;
+
+	flushed += queue_len / 2;
+	queue_len = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+/*
+ * dbgdraw
+ *
+ * immediate-mode debug geometry in world units. lines, rects and crosses are appended to
+ * a CPU array during the frame and dbgdraw_flush uploads them into one streaming VBO and
+ * draws them in a single call. the VBO is split into DBGDRAW_SEGMENTS segments written in
+ * turn with unsynchronized maps, and only orphaned when it wraps around, so an upload never
+ * waits on the GPU reading an earlier one.
+ *
+ * dbgdraw_grid is separate: it draws a line grid procedurally in the fragment shader
+ * over the whole screen, without any geometry.
+ */
+
+#define DBGDRAW_VERTS 8192 /* vertices per flush, lines past this are flushed early */
+#define DBGDRAW_SEGMENTS 4 /* flushes per buffer allocation */
+
+int dbgdraw_init(void);
+void dbgdraw_free(void);
+
+/* col is rgba in [0, 1] */
+void dbgdraw_line(float x0, float y0, float x1, float y1, const float* col);
+void dbgdraw_rect(float x, float y, float w, float h, const float* col); /* outline only */
+void dbgdraw_cross(float x, float y, float size, const float* col);
+
+void dbgdraw_flush(void); /* draws everything queued with the current camera, then clears the queue */
+unsigned dbgdraw_lines(void); /* lines drawn by the last frame's flushes */
+
+/* grid lines every spacing world units, width in pixels, drawn immediately */
+void dbgdraw_grid(float spacing, float width, const float* col);
@@ -1,3 +1,9 @@
 #pragma once
+#include <stdint.h>
 
 #define BLOCKSIZE 16
+
+#define CHUNKSIZE 32 /* tiles per chunk side */
+#define BLOCKPIXELS 16 /* texels per tile side */
+
+typedef uint16_t tile_t; /* global tile id, 0 is the empty tile */
@@ -4,62 +4,213 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <math.h>
 
 #include <GLXW/glxw.h>
 #include <GL/freeglut.h>
 
-#include "stb_image.h"
 #include "tileproto.h"
+#include "defs.h"
 #include "linmath.h"
 #include "text.h"
+#include "overlay.h"
 #include "timer.h"
+#include "chunktab.h"
+#include "wpool.h"
+#include "blocks.h"
+#include "world.h"
+#include "texpool.h"
+#include "wcache.h"
+#include "bench.h"
+#include "fstats.h"
+#include "gpuprof.h"
+#include "dbgdraw.h"
 
-#define BLOCKS 4
-#define CHUNKSIZE 32
-#define BLOCKPIXELS 16
 #define FONTSIZE 21
+#define GRAPH_SCALE_MS 50.0f /* frame time at the top of the graph */
 
-#define HACCEL 0.08f
-#define HMAX 0.8f
-#define VACCEL 0.08f
-#define VMAX 0.8f
-#define DECAY 1.2f
-
-static const char* blocktex[BLOCKS] = {
-	NULL,
-	"res/grass.png",
-	"res/stone.png",
-	"res/brick.png"
-};
-
-typedef struct _live_chunk {
-	int cx, cy;
-	unsigned tex, fbo;
-	struct _live_chunk* next, *prev;
-} live_chunk;
+#define COMPILE_BUDGET_MS 4.0f /* per-frame compile time budget, 0 for unlimited */
+#define COMPILE_BUDGET_DRAWS 0 /* per-frame compile draw call budget, 0 for unlimited */
+#define COMPILE_INSTANCED 1 /* default compile path, toggled at runtime with C */
+#define POOL_TARGETS 24 /* pre-allocated chunk render targets, a full view needs up to 9 */
+#define WORLD_BATCH 64 /* visible chunks per page per instanced draw */
+
+#define KEEP_MARGIN 1 /* chunks within this many chunks of the view are kept warm */
+#define CACHE_CHUNKS 20 /* max compiled chunks kept resident, 0 for no limit */
+#define CACHE_BYTES 0 /* max chunk texture bytes kept resident, 0 for no limit */
+#define CHUNK_BYTES (CHUNKSIZE * BLOCKPIXELS * CHUNKSIZE * BLOCKPIXELS * 4)
+
+#define PREFETCH_FRAMES 20.0f /* how many frames of camera motion to load ahead, tuned at runtime with - = */
+#define PREFETCH_BUDGET 4 /* max chunks requested ahead of the camera per frame, 0 disables prefetch */
+#define PREFETCH_MAX 3 /* cap on the lookahead distance, in chunks */
+
+#define LOD_MAX 3 /* super-chunks go up to 2^LOD_MAX chunks a side, at 2 texels per tile */
+#define LOD_PATHS 2 /* unready super-chunks loading their children at once, bounds the pinned textures */
+#define LOD_BAKE_BUDGET 4 /* super-chunk bakes per frame */
+#define LOD_CACHE_CHUNKS 16 /* max baked super-chunks kept resident per level */
+
+#define ZOOM_MIN 0.5f
+#define ZOOM_MAX 12.0f /* enough to reach LOD_MAX */
+#define ZOOM_STEP 1.03f /* per frame while Z or X is held */
+
+#define EDIT_STRESS 5000.0f /* random edits per second when E turns on stress mode without --edit-stress */
+#define EDIT_FILL_ONE_IN 8 /* stress edits that fill a small rect instead of setting one tile */
 
 static unsigned pretex_init = 0;
-static unsigned pretex_texlist[BLOCKS] = {0};
-static unsigned chunk_vbo, chunk_vao, block_vbo, block_vao, line_tex;
-static live_chunk* chunk_list, *chunk_list_tail;
-static float camerax, cameray;
-static float cxspeed, cyspeed;
-static float fps;
-static unsigned fps_count, rc_count, ld_count, fr_count;
-static tp fps_tp;
-
-static tk_font* dbg_font_good, *dbg_font_bad, *dbg_font_warn;
-
-void demo_pretex_query_wdata(int cx, int cy, uint8_t* data); /* cx, cy: chunk numbers */
-live_chunk* demo_pretex_compile_chunk(int cx, int cy);
-void demo_pretex_render_chunk(live_chunk* c);
+static blocks bank;
+static unsigned chunk_vbo, chunk_vao, block_vbo, block_vao, inst_vbo;
+static unsigned tile_vbo, tile_vao, compile_prg, loc_compile_chunksize, loc_compile_rect, loc_compile_blocks;
+static unsigned tile_prg, loc_tile_pos, loc_tile_layer, loc_tile_blocks;
+static unsigned world_prg;
+static chunktab lods[LOD_MAX]; /* super-chunks of level 1 and up, keyed by position in their own grid */
+static unsigned lod_resident[LOD_MAX], total_bakes, bakes, paths;
+static float zoom = 1.0f;
+static int lod;
+static int compile_instanced = COMPILE_INSTANCED;
+static int bounds_grid = 1; /* chunk edges from the grid shader, otherwise from dbgdraw lines */
+static float compile_ms, compile_ms_avg;
+static unsigned compile_n;
+static chunktab chunks;
+static wpool_job** compile_queue;
+static unsigned cq_head, cq_len, cq_cap;
+static unsigned request_gen; /* stamped on each worker job and on the record that asked for it */
+static float compile_budget_ms = COMPILE_BUDGET_MS;
+static unsigned compile_budget_draws = COMPILE_BUDGET_DRAWS;
+static unsigned rc_count, ld_count, fr_count, ph_count;
+static unsigned frame_no, resident, total_compiles, total_evicts, total_reuses;
+static float prefetch_frames = PREFETCH_FRAMES, prefetch_dist;
+static unsigned prefetch_budget = PREFETCH_BUDGET, pf_count, total_late;
+static int keys_down[GLFW_KEY_LAST + 1];
+static float edit_rate, edits_due, edit_per_s, patch_ms, patch_ms_avg, patch_tiles_avg, total_patch_ms, total_compile_ms;
+static unsigned edit_n, patch_n, patch_tiles, total_edits, total_patches, total_patch_tiles;
+static tile_t edit_ids[CHUNKSIZE * CHUNKSIZE]; /* rows of a patch rect packed together for upload */
+
+/* visible chunks bucketed by texpool page, placeholders go with page 0 */
+typedef struct _world_inst {
+	float x, y;
+	int layer; /* -1 draws the placeholder */
+	float scale; /* chunks a side, 1 << level */
+} world_inst;
+
+static world_inst world_insts[TEXPOOL_MAX_PAGES][WORLD_BATCH];
+static int world_len[TEXPOOL_MAX_PAGES], world_draws;
+static tp avg_tp, frame_tp;
+
+static tk_font* dbg_font, *dbg_title;
+static overlay* hud;
+static const float col_good[4] = { 1.0f, 1.0f, 1.0f, 1.0f }, col_warn[4] = { 1.0f, 0.5f, 0.0f, 1.0f }, col_bad[4] = { 1.0f, 0.2f, 0.0f, 1.0f };
+static const float col_bounds[4] = { 0.98f, 0.02f, 0.02f, 1.0f };
+
+/*
+ * instanced compile path: one instance per tile, the tile id comes in as a per-instance
+ * attribute and selects the layer of the block texture array.
+ * rect is the x, y, width, height in tiles being drawn, the whole chunk unless it's a patch
+ */
+static const char* pretex_compile_vs = "#version 330\n"
+			"layout(location = 0) in vec2 position;\n"
+			"layout(location = 1) in vec2 in_texcoord;\n"
+			"layout(location = 2) in uint tile;\n"
+			"uniform int chunksize;\n"
+			"uniform ivec4 rect;\n"
+			"out vec2 texcoord;\n"
+			"flat out uint layer;\n"
+			"void main(void) {\n"
+			"	vec2 origin = vec2(rect.xy + ivec2(gl_InstanceID % rect.z, gl_InstanceID / rect.z));\n"
+			"	gl_Position = vec4((position + origin) * (2.0 / float(chunksize)) - 1.0, 0.0, 1.0);\n"
+			"	texcoord = in_texcoord;\n"
+			"	layer = tile;\n"
+			"}\n";
+
+static const char* pretex_compile_fs = "#version 330\n"
+			"uniform sampler2DArray blocks;\n"
+			"in vec2 texcoord;\n"
+			"flat in uint layer;\n"
+			"out vec4 color;\n"
+			"void main(void) {\n"
+			"	color = texture(blocks, vec3(texcoord, float(layer)));\n"
+			"}\n";
+
+/* per-tile compile path: one draw per tile, the tile position and layer are uniforms instead of a matrix and a rebind */
+static const char* pretex_tile_vs = "#version 330\n"
+			"layout(location = 0) in vec2 position;\n"
+			"layout(location = 1) in vec2 in_texcoord;\n"
+			"uniform vec2 tile;\n"
+			"uniform int chunksize;\n"
+			"out vec2 texcoord;\n"
+			"void main(void) {\n"
+			"	gl_Position = vec4((position + tile) * (2.0 / float(chunksize)) - 1.0, 0.0, 1.0);\n"
+			"	texcoord = in_texcoord;\n"
+			"}\n";
+
+static const char* pretex_tile_fs = "#version 330\n"
+			"uniform sampler2DArray blocks;\n"
+			"uniform int layer;\n"
+			"in vec2 texcoord;\n"
+			"out vec4 color;\n"
+			"void main(void) {\n"
+			"	color = texture(blocks, vec3(texcoord, float(layer)));\n"
+			"}\n";
+
+/*
+ * world pass: one instance per visible chunk, offset in tiles and layer in the page's array texture.
+ * super-chunks are the same quad scaled up
+ */
+static const char* pretex_world_vs = "#version 330\n"
+			CAMERA_BLOCK
+			"layout(location = 0) in vec2 position;\n"
+			"layout(location = 1) in vec2 in_texcoord;\n"
+			"layout(location = 2) in vec2 offset;\n"
+			"layout(location = 3) in int in_layer;\n"
+			"layout(location = 4) in float scale;\n"
+			"out vec2 texcoord;\n"
+			"flat out int layer;\n"
+			"void main(void) {\n"
+			"	gl_Position = viewproj * vec4(position * scale + offset, 0.0, 1.0);\n"
+			"	texcoord = in_texcoord;\n"
+			"	layer = in_layer;\n"
+			"}\n";
+
+static const char* pretex_world_fs = "#version 330\n"
+			"uniform sampler2DArray chunks;\n"
+			"uniform vec4 placeholder;\n"
+			"in vec2 texcoord;\n"
+			"flat in int layer;\n"
+			"out vec4 color;\n"
+			"void main(void) {\n"
+			"	color = layer < 0 ? placeholder : texture(chunks, vec3(texcoord, float(layer)));\n"
+			"}\n";
+
+const tile_t* demo_pretex_query_wdata(int cx, int cy, tile_t* scratch); /* cx, cy: chunk numbers */
+void demo_pretex_prepare_chunk(wpool_job* job); /* worker thread */
+int demo_pretex_compile_chunk(live_chunk* c, const tile_t* blockdata);
+void demo_pretex_draw_tiles(const tile_t* tiles, const int* rect); /* into the bound target, rect: x0, y0, x1, y1 */
+void demo_pretex_apply_edits(float frame_ms);
+void demo_pretex_patch_chunk(live_chunk* c);
+void demo_pretex_render_chunk(live_chunk* c); /* queues the chunk for demo_pretex_render_world */
+void demo_pretex_queue_inst(int page, float x, float y, int layer, float scale);
+void demo_pretex_render_world(void);
 void demo_pretex_free_chunk(live_chunk* c);
 
-void demo_pretex_request_chunk(int cx, int cy);
+int demo_pretex_pick_lod(void);
+void demo_pretex_request_lods(void); /* also bakes whatever has its children ready */
+void demo_pretex_render_lods(void);
+live_chunk* demo_pretex_need_lod(int level, int x, int y); /* the ready record, or NULL while it's on its way */
+void demo_pretex_draw_lod(int level, int x, int y);
+int demo_pretex_bake(live_chunk* c, int level);
+void demo_pretex_free_lod(live_chunk* c, int level);
+void demo_pretex_evict_lods(void);
+
+int demo_pretex_request_chunk(int cx, int cy);
+void demo_pretex_prefetch(void);
+void demo_pretex_collect_chunks(void);
+void demo_pretex_compile_queued(void);
+void demo_pretex_evict(void);
 int demo_pretex_chunk_loaded(int cx, int cy);
 void demo_pretex_render_chunk_boundaries(void);
 
 unsigned demo_pretex_load_tex(const char* tex);
+int demo_pretex_key_pressed(int key);
 
 int demo_pretex_render(void) {
 	if (!pretex_init) {
@@ -81,86 +232,214 @@ int demo_pretex_render(void) {
 
 	//test_chunk = demo_pretex_compile_chunk(0, 0);
 
-	if (glfwGetKey(wh, GLFW_KEY_RIGHT)) {
-		cxspeed += HACCEL;
-	}
-
-	if (glfwGetKey(wh, GLFW_KEY_LEFT)) {
-		cxspeed -= HACCEL;
-	}
-
-	if (glfwGetKey(wh, GLFW_KEY_UP)) {
-		cyspeed += VACCEL;
-	}
-
-	if (glfwGetKey(wh, GLFW_KEY_DOWN)) {
-		cyspeed -= VACCEL;
+	/* every frame's time, start to start so it includes the swap */
+	float frame_ms = frame_tp ? timer_diff(frame_tp) : 0.0f;
+	if (frame_tp) fstats_frame(frame_ms);
+	frame_tp = timer_get();
+	frame_no++;
+
+	TIMER_ZONE_BEGIN_FRAME("demo_pretex_render", frame_no);
+	gpuprof_frame();
+
+	/* zoom scales the view, past a threshold the world is drawn from super-chunks instead */
+	if (glfwGetKey(wh, GLFW_KEY_Z) == GLFW_PRESS) zoom *= ZOOM_STEP;
+	if (glfwGetKey(wh, GLFW_KEY_X) == GLFW_PRESS) zoom /= ZOOM_STEP;
+	if (zoom < ZOOM_MIN) zoom = ZOOM_MIN;
+	if (zoom > ZOOM_MAX) zoom = ZOOM_MAX;
+
+	camera[2] = CAMERASIZE * RATIO * zoom;
+	camera[3] = CAMERASIZE * zoom;
+	camera_update();
+	lod = demo_pretex_pick_lod();
+
+	if (demo_pretex_key_pressed(GLFW_KEY_R)) fstats_reset();
+	if (demo_pretex_key_pressed(GLFW_KEY_G)) bounds_grid = !bounds_grid;
+	if (demo_pretex_key_pressed(GLFW_KEY_E)) edit_rate = edit_rate > 0.0f ? 0.0f : opt_edit_stress > 0.0f ? opt_edit_stress : EDIT_STRESS;
+
+	if (demo_pretex_key_pressed(GLFW_KEY_RIGHT_BRACKET)) compile_budget_ms += 1.0f;
+	if (demo_pretex_key_pressed(GLFW_KEY_LEFT_BRACKET) && compile_budget_ms >= 1.0f) compile_budget_ms -= 1.0f;
+
+	if (demo_pretex_key_pressed(GLFW_KEY_C)) {
+		compile_instanced = !compile_instanced;
+		compile_ms = compile_ms_avg = 0.0f;
+		compile_n = 0;
 	}
 
-	if (fabs(cxspeed) > HMAX) cxspeed /= (fabs(cxspeed)/HMAX);
-	if (fabs(cyspeed) > VMAX) cyspeed /= (fabs(cyspeed)/VMAX);
-
-	camerax += cxspeed;
-	cameray += cyspeed;
-
-	cxspeed /= DECAY;
-	cyspeed /= DECAY;
-
-	mat4x4_translate(view, -camerax, -cameray, 0.0f);
+	if (demo_pretex_key_pressed(GLFW_KEY_EQUAL)) prefetch_frames += 5.0f;
+	if (demo_pretex_key_pressed(GLFW_KEY_MINUS) && prefetch_frames >= 5.0f) prefetch_frames -= 5.0f;
 
 	glUseProgram(prg);
 
-	for (int cx = ((int) camerax / (int) CHUNKSIZE); cx * CHUNKSIZE < camerax + CAMERASIZE*RATIO; ++cx) {
+	/* zoomed out, chunks are only loaded as children of the super-chunks being baked */
+	for (int cx = ((int) camerax / (int) CHUNKSIZE); !lod && cx * CHUNKSIZE < camerax + camera[2]; ++cx) {
 		if (cx < 0) continue;
-		for (int cy = ((int) cameray / (int) CHUNKSIZE); cy * CHUNKSIZE < cameray + CAMERASIZE; ++cy) {
+		for (int cy = ((int) cameray / (int) CHUNKSIZE); cy * CHUNKSIZE < cameray + camera[3]; ++cy) {
 			if (cy < 0) continue;
 			demo_pretex_request_chunk(cx, cy);
 		}
 	}
 
-	live_chunk* c = chunk_list, *tmp;
+	if (!lod) demo_pretex_prefetch();
+	demo_pretex_collect_chunks();
+	gpuprof_begin(GPU_COMPILE);
+	demo_pretex_compile_queued();
+	demo_pretex_apply_edits(frame_ms);
+	if (lod) demo_pretex_request_lods();
+	gpuprof_end(GPU_COMPILE);
+
+	/*
+	 * residency: chunks in view are drawn, chunks within KEEP_MARGIN of the view are kept warm,
+	 * anything further out stays resident until the LRU limit pushes it out in demo_pretex_evict.
+	 * this keeps jittering across a chunk edge from recompiling the same chunk over and over
+	 */
+
+	live_chunk* c;
+	unsigned it = 0;
+	float margin = KEEP_MARGIN * CHUNKSIZE;
+
+	gpuprof_begin(GPU_WORLD);
+
+	while ((c = chunktab_next(&chunks, &it))) {
+		float x0 = c->cx * CHUNKSIZE, x1 = x0 + CHUNKSIZE, y0 = c->cy * CHUNKSIZE, y1 = y0 + CHUNKSIZE;
 
-	while (c) {
-		if (c->cx * CHUNKSIZE >= camerax + CAMERASIZE*RATIO || (c->cx+1) * CHUNKSIZE <= camerax || (c->cy+1)*CHUNKSIZE <= cameray || c->cy*CHUNKSIZE >= cameray+CAMERASIZE) {
-			tmp = c->next;
-			demo_pretex_free_chunk(c);
-			c = tmp;
+		int visible = x0 < camerax + camera[2] && x1 > camerax && y1 > cameray && y0 < cameray + camera[3];
+		int near = x0 < camerax + camera[2] + margin && x1 > camerax - margin && y1 > cameray - margin && y0 < cameray + camera[3] + margin;
+
+		/* prefetched chunks and super-chunk children were touched this frame already */
+		if (!near && c->state != CHUNK_READY && c->last_used != frame_no) {
+			demo_pretex_free_chunk(c); /* not worth finishing, leaves a tombstone so it's safe while iterating */
 			continue;
 		}
 
+		if (near) c->last_used = frame_no;
+		if (lod || !visible) continue;
+
+		/* came back into view without needing a compile */
+		if (c->state == CHUNK_READY && c->last_visible && c->last_visible != frame_no - 1) total_reuses++;
+
+		/* needed on screen before it was ready */
+		if (c->state != CHUNK_READY && !c->last_visible) total_late++;
+		c->last_visible = frame_no;
+
 		demo_pretex_render_chunk(c);
-		c = c->next;
 	}
 
+	if (lod) demo_pretex_render_lods();
+	demo_pretex_render_world();
+	gpuprof_end(GPU_WORLD);
+	demo_pretex_evict();
+	demo_pretex_evict_lods();
+
+	gpuprof_begin(GPU_BOUNDS);
 	demo_pretex_render_chunk_boundaries();
+	gpuprof_end(GPU_BOUNDS);
+
+	float avg_ms = timer_diff(avg_tp);
+
+	if (avg_ms >= 250.0f) {
+		avg_tp = timer_get();
+
+		if (compile_n) compile_ms_avg = compile_ms / compile_n;
+		compile_ms = 0.0f;
+		compile_n = 0;
+
+		if (patch_n) {
+			patch_ms_avg = patch_ms / patch_n;
+			patch_tiles_avg = (float) patch_tiles / patch_n;
+		}
+
+		edit_per_s = edit_n * 1000.0f / avg_ms;
+		patch_ms = 0.0f;
+		edit_n = patch_n = patch_tiles = 0;
+	}
+
+	gpuprof_begin(GPU_HUD);
+
+	/* coloured by the tail, that's where compile spikes show up */
+	float p99 = fstats_percentile(99.0f);
+	const float* col_fps = col_good;
+
+	if (p99 > 16.7f) col_fps = col_warn;
+	if (p99 > 33.3f) col_fps = col_bad;
+
+	char fr_head[64], fr_tail[16], fr_rest[48];
+	snprintf(fr_head, sizeof fr_head, "frame ms: p50 %.2f p95 %.2f ", fstats_percentile(50.0f), fstats_percentile(95.0f));
+	snprintf(fr_tail, sizeof fr_tail, "p99 %.2f", p99);
+	snprintf(fr_rest, sizeof fr_rest, " max %.2f (%u frames)", fstats_max(), fstats_count());
+
+	tk_span fr_spans[] = { { NULL, fr_head }, { col_fps, fr_tail }, { NULL, fr_rest } };
+
+	overlay_begin(hud);
+	overlay_text(hud, dbg_title, NULL, 10, HEIGHT - 25, 0, "Chunk pretexturing demo");
+	overlay_spans(hud, dbg_font, 10, HEIGHT - FONTSIZE - 25, 0, fr_spans, 3);
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - FONTSIZE*2 - 25, 0, "chunksize=%d ppb=%d blocks=%d cx=%.2f cy=%.2f |cvel|=%.2f", CHUNKSIZE, BLOCKPIXELS, bank.count, camerax, cameray, sqrt(cxspeed*cxspeed+cyspeed*cyspeed));
+
+	const float* col_chunkstat = col_good;
+	if (rc_count > 2 || ld_count > 1) col_chunkstat = col_warn;
+	if (rc_count > 5 || ld_count > 2) col_chunkstat = col_bad;
 
-	fps_count++;
+	overlay_text(hud, dbg_font, col_chunkstat, 10, HEIGHT - FONTSIZE*3 - 25, 0, "rendered %d, compiled %d, freed %d, debug lines %u (%s bounds)", rc_count, ld_count, fr_count, dbgdraw_lines(), bounds_grid ? "grid shader" : "line");
 
-	const int g = 4;
+	const float* col_queue = ph_count ? col_warn : col_good;
 
-	if (timer_diff(fps_tp) >= 1000.0f / g) {
-		fps = fps_count / (timer_diff(fps_tp) / 1000.0f);
-		fps_tp = timer_get();
-		fps_count = 0;
+	overlay_text(hud, dbg_font, col_queue, 10, HEIGHT - FONTSIZE*4 - 25, 0, "workers %d, loading %d, compile queue %d, placeholders %d, budget %.0fms/%d draws", wpool_workers(), wpool_pending(), cq_len, ph_count, compile_budget_ms, compile_budget_draws);
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - FONTSIZE*5 - 25, 0, "compile path: %s, %.3f ms/chunk (cpu)", compile_instanced ? "instanced" : "per-tile", compile_ms_avg);
+
+	const texpool_stats* ps = texpool_get_stats();
+	const float* col_pool = ps->misses ? col_warn : col_good; /* the pool had to grow past POOL_TARGETS */
+
+	overlay_text(hud, dbg_font, col_pool, 10, HEIGHT - FONTSIZE*6 - 25, 0, "texpool %d/%d in use in %d pages, %u hits, %u misses, world drawn in %d draws", ps->in_use, ps->capacity, ps->pages, ps->hits, ps->misses, world_draws);
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - FONTSIZE*7 - 25, 0, "resident %d (%d MB), total compiles %u, evictions %u, reuses %u", resident, resident * (CHUNK_BYTES / 1024) / 1024, total_compiles, total_evicts, total_reuses);
+
+	const float* col_prefetch = total_late ? col_warn : col_good;
+
+	overlay_text(hud, dbg_font, col_prefetch, 10, HEIGHT - FONTSIZE*8 - 25, 0, "prefetch %.0f frames (%.1f tiles ahead), %d/%d requested, needed but not ready %u", prefetch_frames, prefetch_dist, pf_count, prefetch_budget, total_late);
+
+	wcache_stats ws = wcache_get_stats();
+	float ws_bits = ws.entries ? ws.bytes * 8.0f / (ws.entries * CHUNKSIZE * CHUNKSIZE) : 0.0f;
+
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - FONTSIZE*9 - 25, 0, "world cache %u chunks, %zu/%zu KB (%zu KB raw, %.2f bits/tile), %u hits, %u misses", ws.entries, ws.bytes / 1024, ws.budget / 1024, ws.raw_bytes / 1024, ws_bits, ws.hits, ws.misses);
+
+	size_t edit_bytes;
+	unsigned edited = world_edited(&edit_bytes); /* only freed on world_close, a long stress run keeps growing it */
+
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - FONTSIZE*11 - 25, 0, "edits %.0f/s (stress %s), %u chunks held (%zu KB), %u patches, %.1f tiles/patch, %.3f ms/patch vs %.3f ms/compile", edit_per_s, edit_rate > 0.0f ? "on" : "off", edited, edit_bytes / 1024, total_patches, patch_tiles_avg, patch_ms_avg, compile_ms_avg);
+
+	char vram[64];
+	int vlen = 0;
+
+	for (int l = 0; l <= LOD_MAX; ++l) {
+		unsigned n = l ? lod_resident[l - 1] : resident;
+		vlen += snprintf(vram + vlen, sizeof vram - vlen, "%sL%d %u", l ? ", " : "", l, n * (CHUNK_BYTES / 1024) / 1024);
 	}
 
-	tk_font* dbg_font_fps = dbg_font_good;
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - FONTSIZE*12 - 25, 0, "zoom %.2f, lod %d, %u super-chunk bakes, VRAM MB per lod: %s", zoom, lod, total_bakes, vram);
+	overlay_text(hud, dbg_font, NULL, 10, 10, 0, "controls: arrow keys to move, [ ] compile budget, - = prefetch, C compile path, G grid, E edit stress, R reset stats");
 
-	if (fps < 60) dbg_font_fps = dbg_font_warn;
-	if (fps < 30) dbg_font_fps = dbg_font_bad;
+	overlay_text(hud, dbg_font, NULL, WIDTH - 10 - FSTATS_RING, HEIGHT - 130 - FONTSIZE, 0, "frame time, last %d frames (%.0f ms full scale)", FSTATS_RING, GRAPH_SCALE_MS);
 
-	tk_font_render(dbg_font_good, 10, HEIGHT - 25, 0, "Chunk pretexturing demo");
-	tk_font_render(dbg_font_fps, 10, HEIGHT - FONTSIZE - 25, 0, "FPS [g=%d]: %.2f\n", g, fps);
-	tk_font_render(dbg_font_good, 10, HEIGHT - FONTSIZE*2 - 25, 0, "chunksize=%d ppb=%d cx=%.2f cy=%.2f |cvel|=%.2f", CHUNKSIZE, BLOCKPIXELS, camerax, cameray, sqrt(cxspeed*cxspeed+cyspeed*cyspeed));
+	/* drawn a frame late, the hud can't time itself in the same frame */
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - FONTSIZE*10 - 25, 0, "gpu/cpu ms: %s %.2f/%.2f, %s %.2f/%.2f, %s %.2f/%.2f, %s %.2f/%.2f",
+			gpuprof_name(GPU_COMPILE), gpuprof_gpu_ms(GPU_COMPILE), gpuprof_cpu_ms(GPU_COMPILE),
+			gpuprof_name(GPU_WORLD), gpuprof_gpu_ms(GPU_WORLD), gpuprof_cpu_ms(GPU_WORLD),
+			gpuprof_name(GPU_BOUNDS), gpuprof_gpu_ms(GPU_BOUNDS), gpuprof_cpu_ms(GPU_BOUNDS),
+			gpuprof_name(GPU_HUD), gpuprof_gpu_ms(GPU_HUD), gpuprof_cpu_ms(GPU_HUD));
+	overlay_end(hud);
 
-	tk_font* dbg_font_chunkstat = dbg_font_good;
-	if (rc_count > 2 || ld_count > 1) dbg_font_chunkstat = dbg_font_warn;
-	if (rc_count > 5 || ld_count > 2) dbg_font_chunkstat = dbg_font_bad;
+	/* the graph moves every frame, it stays out of the overlay */
+	fstats_draw_graph(WIDTH - 10 - FSTATS_RING, HEIGHT - 130, FSTATS_RING, 120, GRAPH_SCALE_MS);
 
-	tk_font_render(dbg_font_chunkstat, 10, HEIGHT - FONTSIZE*3 - 25, 0, "rendered %d, compiled %d, freed %d\n", rc_count, ld_count, fr_count);
-	tk_font_render(dbg_font_good, 10, 10, 0, "controls: arrow keys to move");
+	/* counting redraws inside the overlay would make every redraw invalidate it again */
+	tk_text_begin();
+	tk_font_render(dbg_font, WIDTH - 10 - FSTATS_RING, HEIGHT - 130 - FONTSIZE*2, 0, "hud redrawn %u times, at most %.0f/s", hud->redraws, hud->rate);
+	tk_text_end();
 
-	rc_count = ld_count = fr_count = 0;
+	gpuprof_end(GPU_HUD);
+
+	bench_compiles(ld_count);
+	rc_count = ld_count = fr_count = ph_count = pf_count = world_draws = 0;
+
+	TIMER_ZONE_END();
 	return 0;
 }
 
@@ -168,34 +447,25 @@ int demo_pretex_init(void) {
 	pretex_init = 1;
 	printf("demo_pretex: initializing\n");
 	printf("demo_pretex: chunk size = %dx%d blocks\n", CHUNKSIZE, CHUNKSIZE);
-	printf("demo_pretex: selecting chunk data from %d distinct blocktypes\n", BLOCKS);
-	printf("demo_pretex: loading block textures");
+	printf("demo_pretex: loading block textures\n");
 
-	fps_tp = timer_get();
+	avg_tp = timer_get();
+	edit_rate = opt_edit_stress;
+	zoom = opt_zoom;
 
-	glGenTextures(BLOCKS - 1, pretex_texlist + 1);
+	if (blocks_load(&bank, opt_blockdir, BLOCKPIXELS)) return 1;
+	printf("demo_pretex: selecting chunk data from %d distinct blocktypes\n", bank.count);
+	world_init(bank.count);
 
-	for (int i = 1; i < BLOCKS; ++i) {
-		int w, h, rw;
-		unsigned char* stbd = stbi_load(blocktex[i], &w, &h, NULL, 4);
-		if (!stbd) {
-			printf("\ntex fail: %s\n", blocktex[i]);
-			return 1;
-		}
-		unsigned char* next = malloc(w*h*4);
-		rw = 4*w;
-		for (int j = 0; j < h; ++j) {
-			memcpy(next + j * rw, stbd + (h-1) * rw - j*rw, rw);
-		}
-		glBindTexture(GL_TEXTURE_2D, pretex_texlist[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, next);
-		free(next);
-		stbi_image_free(stbd);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		printf(".");
+	if (chunktab_init(&chunks, 64)) return 1;
+	for (int l = 0; l < LOD_MAX; ++l) {
+		if (chunktab_init(lods + l, 16)) return 1;
 	}
-	printf(" done\n");
+	if (wpool_init(opt_workers, CHUNKSIZE * CHUNKSIZE * sizeof(tile_t), demo_pretex_prepare_chunk)) return 1;
+	if (texpool_init(POOL_TARGETS, CHUNKSIZE * BLOCKPIXELS, CHUNKSIZE * BLOCKPIXELS)) return 1;
+	if (fstats_init()) return 1;
+	if (gpuprof_init()) return 1;
+	if (dbgdraw_init()) return 1;
 
 	printf("demo_pretex: initializing vertex arrays\n");
 	float verts[] = {
@@ -242,17 +512,77 @@ int demo_pretex_init(void) {
 	glEnableVertexAttribArray(0); /* all VAOs use this so we don't really need to worry about the state too much */
 	glEnableVertexAttribArray(1);
 
-	dbg_font_good = tk_font_init("res/debug.ttf", FONTSIZE);
-	dbg_font_warn = tk_font_init("res/debug.ttf", FONTSIZE);
-	dbg_font_bad = tk_font_init("res/debug.ttf", FONTSIZE);
+	/* per-chunk offset and layer for the world pass, pointed at each page's range when drawn */
+	glGenBuffers(1, &inst_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, inst_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof world_insts, NULL, GL_STREAM_DRAW);
+
+	glVertexAttribDivisor(2, 1);
+	glVertexAttribDivisor(3, 1);
+	glVertexAttribDivisor(4, 1);
+	glEnableVertexAttribArray(2);
+	glEnableVertexAttribArray(3);
+	glEnableVertexAttribArray(4);
+
+	/* block quad plus a streamed per-instance tile id for the instanced compile path */
+	glGenVertexArrays(1, &tile_vao);
+	glBindVertexArray(tile_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, block_vbo);
 
-	tk_font_set_col(dbg_font_good, 1.0f, 1.0f, 1.0f, 1.0f);
-	tk_font_set_col(dbg_font_warn, 1.0f, 0.5f, 0.0f, 1.0f);
-	tk_font_set_col(dbg_font_bad, 1.0f, 0.2f, 0.0f, 1.0f);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float)*4, NULL);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float)*4, (void*) (sizeof(float)*2));
 
-	line_tex = demo_pretex_load_tex("res/line.png");
+	glGenBuffers(1, &tile_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, tile_vbo);
+	glBufferData(GL_ARRAY_BUFFER, CHUNKSIZE * CHUNKSIZE * sizeof(tile_t), NULL, GL_STREAM_DRAW);
 
-	if (!line_tex) return 1;
+	glVertexAttribIPointer(2, 1, GL_UNSIGNED_SHORT, 0, NULL);
+	glVertexAttribDivisor(2, 1);
+
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+
+	compile_prg = make_program(pretex_compile_vs, pretex_compile_fs);
+	if (!compile_prg) return 1;
+
+	glUseProgram(compile_prg);
+	loc_compile_chunksize = glGetUniformLocation(compile_prg, "chunksize");
+	loc_compile_rect = glGetUniformLocation(compile_prg, "rect");
+	loc_compile_blocks = glGetUniformLocation(compile_prg, "blocks");
+	glUniform1i(loc_compile_chunksize, CHUNKSIZE);
+	glUniform1i(loc_compile_blocks, 0);
+
+	tile_prg = make_program(pretex_tile_vs, pretex_tile_fs);
+	if (!tile_prg) return 1;
+
+	glUseProgram(tile_prg);
+	loc_tile_pos = glGetUniformLocation(tile_prg, "tile");
+	loc_tile_layer = glGetUniformLocation(tile_prg, "layer");
+	loc_tile_blocks = glGetUniformLocation(tile_prg, "blocks");
+	glUniform1i(loc_tile_blocks, 0);
+	glUniform1i(glGetUniformLocation(tile_prg, "chunksize"), CHUNKSIZE);
+
+	/* queued chunks are drawn with a flat placeholder colour until they are compiled */
+	world_prg = make_program(pretex_world_vs, pretex_world_fs);
+	if (!world_prg) return 1;
+
+	glUseProgram(world_prg);
+	glUniform1i(glGetUniformLocation(world_prg, "chunks"), 0);
+	glUniform4f(glGetUniformLocation(world_prg, "placeholder"), 40 / 255.0f, 40 / 255.0f, 48 / 255.0f, 1.0f);
+	glUseProgram(prg);
+
+	/* one face, status colours are picked per draw */
+	dbg_font = tk_font_init("res/debug.ttf", FONTSIZE);
+
+	/* the title comes from the distance field atlas, so it can be any size and still outline cleanly */
+	dbg_title = tk_font_init_sdf("res/debug.ttf", FONTSIZE + 3);
+	tk_font_set_outline(dbg_title, 1.5f, 0.0f, 0.0f, 0.0f, 1.0f);
+	tk_font_set_shadow(dbg_title, 2, -2, 0.0f, 0.0f, 0.0f, 0.6f);
+
+	/* HUD text is retained in a layer and only redrawn when it changes */
+	hud = overlay_create(WIDTH, HEIGHT, opt_hud_rate);
+	if (!hud) return 1;
 
 	return 0;
 }
@@ -261,73 +591,135 @@ void demo_pretex_free(void) {
 	if (!pretex_init) return;
 	printf("demo_pretex: cleaning up\n");
 
+	if (total_patches) {
+		printf("demo_pretex: %u edits patched in %u chunk patches, %.3f ms and %.1f tiles per patch, %.3f ms per full compile\n",
+				total_edits, total_patches, total_patch_ms / total_patches, (float) total_patch_tiles / total_patches, total_compiles ? total_compile_ms / total_compiles : 0.0f);
+	}
+
+	live_chunk* c;
+	unsigned it = 0;
+	while ((c = chunktab_next(&chunks, &it))) demo_pretex_free_chunk(c);
+	chunktab_free(&chunks);
+
+	for (int l = 0; l < LOD_MAX; ++l) {
+		it = 0;
+		while ((c = chunktab_next(lods + l, &it))) demo_pretex_free_lod(c, l + 1);
+		chunktab_free(lods + l);
+	}
+
+	camera[2] = CAMERASIZE * RATIO;
+	camera[3] = CAMERASIZE;
+
+	while (cq_len) {
+		wpool_release(compile_queue[cq_head]);
+		cq_head = (cq_head + 1) % cq_cap;
+		cq_len--;
+	}
+
+	free(compile_queue);
+	compile_queue = NULL;
+	cq_head = cq_cap = 0;
+
+	wpool_free();
+	texpool_free();
+
+	if (opt_frame_csv) fstats_dump_csv(opt_frame_csv);
+	fstats_free();
+	gpuprof_free();
+	dbgdraw_free();
+
 	glDeleteBuffers(1, &block_vbo);
 	glDeleteVertexArrays(1, &block_vao);
 	glDeleteBuffers(1, &chunk_vbo);
 	glDeleteVertexArrays(1, &chunk_vao);
+	glDeleteBuffers(1, &tile_vbo);
+	glDeleteVertexArrays(1, &tile_vao);
+	glDeleteProgram(compile_prg);
+	glDeleteProgram(tile_prg);
 
-	glDeleteTextures(BLOCKS - 1, pretex_texlist + 1);
+	blocks_free(&bank);
+	glDeleteBuffers(1, &inst_vbo);
+	glDeleteProgram(world_prg);
 
-	tk_font_free(dbg_font_good);
-	tk_font_free(dbg_font_warn);
-	tk_font_free(dbg_font_bad);
+	tk_font_free(dbg_font);
+	tk_font_free(dbg_title);
+	dbg_font = dbg_title = NULL;
 
-	dbg_font_good = NULL;
-	dbg_font_warn = NULL;
-	dbg_font_bad = NULL;
+	overlay_free(hud);
+	hud = NULL;
 }
 
-void demo_pretex_query_wdata(int cx, int cy, uint8_t* dest) {
-	/*
-	 * normally this would pull world information from the disk.
-	 * however, for the purposes of this demo random data will suffice.
-	 */
+const tile_t* demo_pretex_query_wdata(int cx, int cy, tile_t* scratch) {
+	TIMER_ZONE_BEGIN_CHUNK("demo_pretex_query_wdata", cx, cy);
+	const tile_t* tiles = world_query(cx, cy, scratch);
+	TIMER_ZONE_END();
+	return tiles;
+}
 
-	for (int i = 0; i < CHUNKSIZE*CHUNKSIZE; ++i) {
-		dest[i] = rand() % BLOCKS;
-	}
+void demo_pretex_prepare_chunk(wpool_job* job) {
+	job->tiles = demo_pretex_query_wdata(job->cx, job->cy, (tile_t*) job->data);
 }
 
 void demo_pretex_render_chunk(live_chunk* c) {
-	/* this is fortunately rather straightforward.
-	 * we translate the chunk VBO over and render with the live chunk texture */
-
+	/* nothing is drawn here, the chunk is added to its page's instances */
 	rc_count++;
+	if (c->state != CHUNK_READY) ph_count++;
 
-	mat4x4_translate(model, c->cx * CHUNKSIZE, c->cy * CHUNKSIZE, 0.0f);
-	update_mats();
-	glBindVertexArray(chunk_vao);
-	glBindTexture(GL_TEXTURE_2D, c->tex);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	if (c->state == CHUNK_READY) {
+		demo_pretex_queue_inst(c->target.page, c->cx * CHUNKSIZE, c->cy * CHUNKSIZE, c->target.layer, 1.0f);
+	} else {
+		demo_pretex_queue_inst(0, c->cx * CHUNKSIZE, c->cy * CHUNKSIZE, -1, 1.0f);
+	}
 }
 
-live_chunk* demo_pretex_compile_chunk(int cx, int cy) {
-	live_chunk* output = malloc(sizeof *output);
+void demo_pretex_queue_inst(int page, float x, float y, int layer, float scale) {
+	if (world_len[page] == WORLD_BATCH) demo_pretex_render_world();
 
-	ld_count++;
+	world_inst* i = world_insts[page] + world_len[page]++;
+	i->x = x;
+	i->y = y;
+	i->layer = layer;
+	i->scale = scale;
+}
 
-	output->cx = cx;
-	output->cy = cy;
-	output->next = output->prev = NULL;
-	glGenTextures(1, &output->tex);
-	glBindTexture(GL_TEXTURE_2D, output->tex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, CHUNKSIZE * BLOCKPIXELS, CHUNKSIZE * BLOCKPIXELS, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+void demo_pretex_render_world(void) {
+	/* one upload for every page, then one instanced draw per page that has visible chunks */
+	glUseProgram(world_prg);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindVertexArray(chunk_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, inst_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof world_insts, NULL, GL_STREAM_DRAW); /* orphan last frame's instances */
 
-	glGenFramebuffers(1, &output->fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, output->fbo);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, output->tex, 0);
+	for (int p = 0; p < TEXPOOL_MAX_PAGES; ++p) {
+		if (!world_len[p]) continue;
 
-	GLenum db[1] = {GL_COLOR_ATTACHMENT0};
-	glDrawBuffers(1, db);
+		size_t base = sizeof world_insts[p] * p;
+		glBufferSubData(GL_ARRAY_BUFFER, base, sizeof(world_inst) * world_len[p], world_insts[p]);
 
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-		printf("demo_pretex: FBO init failed\n");
-		return NULL;
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(world_inst), (void*) (base + offsetof(world_inst, x)));
+		glVertexAttribIPointer(3, 1, GL_INT, sizeof(world_inst), (void*) (base + offsetof(world_inst, layer)));
+		glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(world_inst), (void*) (base + offsetof(world_inst, scale)));
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texpool_page_tex(p));
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, world_len[p]);
+
+		world_len[p] = 0;
+		world_draws++;
+	}
+
+	glUseProgram(prg);
+}
+
+int demo_pretex_compile_chunk(live_chunk* output, const tile_t* blockdata) {
+	tp start = timer_get();
+
+	TIMER_ZONE_BEGIN_CHUNK("demo_pretex_compile_chunk", output->cx, output->cy);
+
+	/* render targets are recycled through the pool instead of allocated per compile */
+	if (texpool_borrow(&output->target)) {
+		printf("demo_pretex: no render target for chunk %d, %d\n", output->cx, output->cy);
+		TIMER_ZONE_END();
+		return 1;
 	}
 
 	/*
@@ -340,132 +732,603 @@ live_chunk* demo_pretex_compile_chunk(int cx, int cy) {
 	 * so, we have to set up an FBO and prepare to render to it
 	 * we may also have to perform hblock reduction and appropriate VBO generation here
 	 * as a result this is the primary source of overhead in the technique
+	 *
+	 * the block data itself was already prepared by a worker thread, so only the GL work is left here
 	 */
 
-	uint8_t blockdata[CHUNKSIZE * CHUNKSIZE];
-	demo_pretex_query_wdata(0, 0, blockdata);
-
 	/* generating hblocks and VBOs might be so costly that it will be better to just render each block individually */
 
-	glBindFramebuffer(GL_FRAMEBUFFER, output->fbo);
-	glBindVertexArray(block_vao);
+	glBindFramebuffer(GL_FRAMEBUFFER, output->target.fbo);
 	glViewport(0, 0, CHUNKSIZE * BLOCKPIXELS, CHUNKSIZE * BLOCKPIXELS);
+	glClear(GL_COLOR_BUFFER_BIT); /* a recycled target still holds the previous chunk */
+
+	static const int whole[4] = { 0, 0, CHUNKSIZE, CHUNKSIZE };
+	demo_pretex_draw_tiles(blockdata, whole);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, screen_fbo);
+	glViewport(0, 0, WIDTH, HEIGHT);
+
+	float ms = timer_diff(start);
+	compile_ms += ms;
+	total_compile_ms += ms;
+	compile_n++;
+	ld_count++;
+	total_compiles++;
+
+	output->state = CHUNK_READY;
+	resident++;
+
+	/* the worker may have read the tiles before an edit landed */
+	if (output->dirty[2]) demo_pretex_patch_chunk(output);
+
+	TIMER_ZONE_END();
+	return 0;
+}
+
+void demo_pretex_draw_tiles(const tile_t* tiles, const int* rect) {
+	int w = rect[2] - rect[0], h = rect[3] - rect[1];
+
+	/* every block type lives in one array texture, so it is bound once for either path */
+	glBindTexture(GL_TEXTURE_2D_ARRAY, bank.tex);
+
+	if (compile_instanced) {
+		/* upload the tile ids once and draw every tile with a single instanced call */
+		const tile_t* ids = tiles + rect[0] + rect[1] * CHUNKSIZE;
+
+		if (w < CHUNKSIZE) {
+			for (int y = 0; y < h; ++y) memcpy(edit_ids + y * w, ids + y * CHUNKSIZE, w * sizeof *ids);
+			ids = edit_ids;
+		}
+
+		glUseProgram(compile_prg);
+		glUniform4i(loc_compile_rect, rect[0], rect[1], w, h);
+		glBindVertexArray(tile_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, tile_vbo);
+		glBufferData(GL_ARRAY_BUFFER, CHUNKSIZE * CHUNKSIZE * sizeof(tile_t), NULL, GL_STREAM_DRAW); /* orphan last chunk's ids */
+		glBufferSubData(GL_ARRAY_BUFFER, 0, w * h * sizeof(tile_t), ids);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, w * h);
+	} else {
+		glUseProgram(tile_prg);
+		glBindVertexArray(block_vao);
+
+		for (int y = rect[1]; y < rect[3]; ++y) {
+			for (int x = rect[0]; x < rect[2]; ++x) {
+				/* render the block located at (x, y) relative to the chunk origin into the texture */
+				glUniform2f(loc_tile_pos, x, y);
+				glUniform1i(loc_tile_layer, tiles[x + y * CHUNKSIZE]);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
+		}
+	}
+
+	glUseProgram(prg);
+}
+
+void demo_pretex_apply_edits(float frame_ms) {
+	/*
+	 * stress mode scatters random edits over the view, a few of them small fills.
+	 * then every chunk edited this frame is patched once, however many edits it got
+	 */
+
+	if (edit_rate > 0.0f) {
+		edits_due += edit_rate * frame_ms / 1000.0f;
+		if (edits_due > edit_rate) edits_due = edit_rate; /* don't try to catch up after a stall */
+
+		for (; edits_due >= 1.0f; edits_due -= 1.0f) {
+			int tx = (int) camerax + rand() % (int) camera[2], ty = (int) cameray + rand() % (int) camera[3];
+			tile_t id = rand() % bank.count;
 
-	mat4x4 xform, final;
-	mat4x4_ortho(xform, 0.0f, CHUNKSIZE, 0.0f, CHUNKSIZE, -0.1f, 0.1f);
+			if (rand() % EDIT_FILL_ONE_IN) {
+				world_set_tile(tx, ty, id);
+			} else {
+				world_fill_rect(tx, ty, 1 + rand() % 4, 1 + rand() % 4, id);
+			}
 
-	for (int y = 0; y < CHUNKSIZE; ++y) {
-		for (int x = 0; x < CHUNKSIZE; ++x) {
-			/* render the block located at (x, y) relative to the chunk origin into the texture */
-			mat4x4_translate(model, x, y, 0);
-			mat4x4_mul(final, xform, model);
-			glUniformMatrix4fv(loc_xform, 1, GL_FALSE, (float*) *final);
+			edit_n++;
+			total_edits++;
+		}
+	}
+
+	int cx, cy, r[4];
+
+	while (world_next_dirty(&cx, &cy, r)) {
+		/* super-chunks over it keep drawing their old texture until they are rebaked */
+		for (int l = 1; l <= LOD_MAX; ++l) {
+			live_chunk* s = chunktab_find(lods + l - 1, cx >> l, cy >> l);
+			if (s) s->stale = 1;
+		}
 
-			glBindTexture(GL_TEXTURE_2D, pretex_texlist[blockdata[x + y * CHUNKSIZE]]);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+		live_chunk* c = chunktab_find(&chunks, cx, cy);
+		if (!c) continue; /* a later request reads the edited tiles, jobs already in flight are dropped by generation */
+
+		int* d = c->dirty;
+
+		if (!d[2]) {
+			memcpy(d, r, sizeof r);
+		} else {
+			if (r[0] < d[0]) d[0] = r[0];
+			if (r[1] < d[1]) d[1] = r[1];
+			if (r[2] > d[2]) d[2] = r[2];
+			if (r[3] > d[3]) d[3] = r[3];
 		}
+
+		/* anything not compiled yet is patched right after its compile */
+		if (c->state == CHUNK_READY) demo_pretex_patch_chunk(c);
 	}
+}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void demo_pretex_patch_chunk(live_chunk* c) {
+	/*
+	 * redraw only the edited rect of a compiled chunk. the clear is scissored to the rect,
+	 * the rest of the target keeps whatever the last compile or patch drew
+	 */
+
+	static tile_t scratch[CHUNKSIZE * CHUNKSIZE];
+	const tile_t* tiles = world_query(c->cx, c->cy, scratch);
+	int* r = c->dirty;
+
+	TIMER_ZONE_BEGIN_CHUNK("demo_pretex_patch_chunk", c->cx, c->cy);
+	tp start = timer_get();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, c->target.fbo);
+	glViewport(0, 0, CHUNKSIZE * BLOCKPIXELS, CHUNKSIZE * BLOCKPIXELS);
+
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(r[0] * BLOCKPIXELS, r[1] * BLOCKPIXELS, (r[2] - r[0]) * BLOCKPIXELS, (r[3] - r[1]) * BLOCKPIXELS);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+
+	demo_pretex_draw_tiles(tiles, r);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, screen_fbo);
 	glViewport(0, 0, WIDTH, HEIGHT);
 
-	return output;
+	float ms = timer_diff(start);
+	unsigned n = (r[2] - r[0]) * (r[3] - r[1]);
+
+	patch_ms += ms;
+	patch_tiles += n;
+	patch_n++;
+	total_patch_ms += ms;
+	total_patch_tiles += n;
+	total_patches++;
+
+	r[2] = 0;
+	TIMER_ZONE_END();
 }
 
 void demo_pretex_free_chunk(live_chunk* c) {
-	glDeleteTextures(1, &c->tex);
-	glDeleteFramebuffers(1, &c->fbo);
+	if (c->state == CHUNK_READY) {
+		texpool_return(&c->target);
+		resident--;
+	}
 
-	if (c->prev) {
-		c->prev->next = c->next;
-	} else {
-		chunk_list = c->next;
+	chunktab_erase(&chunks, c);
+	fr_count++;
+}
+
+int demo_pretex_chunk_loaded(int cx, int cy) {
+	return chunktab_find(&chunks, cx, cy) != NULL;
+}
+
+int demo_pretex_request_chunk(int cx, int cy) {
+	if (demo_pretex_chunk_loaded(cx, cy)) return 0;
+
+	/* if every worker is saturated just try again next frame */
+	if (wpool_submit(cx, cy, ++request_gen)) return 0;
+
+	live_chunk* c = chunktab_insert(&chunks, cx, cy);
+
+	if (c) {
+		c->state = CHUNK_LOADING;
+		c->gen = request_gen;
 	}
+	return 1;
+}
 
-	if (c->next) {
-		c->next->prev = c->prev;
-	} else {
-		chunk_list_tail = c->prev;
+void demo_pretex_prefetch(void) {
+	/*
+	 * request the chunks the view will cover a little while from now.
+	 * the lead time is the lookahead plus however many frames the compile queue will take to drain,
+	 * so a slow compile path looks further ahead at the same speed.
+	 */
+
+	float budget = compile_budget_ms > 0.0f ? compile_budget_ms : 16.0f;
+	float lead = prefetch_frames + (cq_len + 1) * compile_ms_avg / budget;
+	float dx = cxspeed * lead, dy = cyspeed * lead;
+	float dmax = PREFETCH_MAX * CHUNKSIZE;
+
+	prefetch_dist = sqrt(dx*dx + dy*dy);
+
+	if (prefetch_dist > dmax) {
+		dx *= dmax / prefetch_dist;
+		dy *= dmax / prefetch_dist;
+		prefetch_dist = dmax;
 	}
 
-	free(c);
-	fr_count++;
+	if (!prefetch_budget || prefetch_dist < 1.0f) return;
+
+	float px = camerax + dx, py = cameray + dy;
+
+	/* walk the predicted view nearest-first along the motion so the budget goes to what's needed soonest */
+	int x0 = (int) floorf(px / CHUNKSIZE), x1 = (int) floorf((px + camera[2]) / CHUNKSIZE);
+	int y0 = (int) floorf(py / CHUNKSIZE), y1 = (int) floorf((py + camera[3]) / CHUNKSIZE);
+
+	for (int i = 0; i <= x1 - x0; ++i) {
+		int cx = dx >= 0.0f ? x0 + i : x1 - i;
+		if (cx < 0) continue;
+
+		for (int j = 0; j <= y1 - y0; ++j) {
+			int cy = dy >= 0.0f ? y0 + j : y1 - j;
+			if (cy < 0) continue;
+
+			int fresh = demo_pretex_request_chunk(cx, cy);
+
+			live_chunk* c = chunktab_find(&chunks, cx, cy);
+			if (c) c->last_used = frame_no; /* keeps it from being culled before it comes into view */
+
+			if (fresh && ++pf_count >= prefetch_budget) return;
+		}
+	}
 }
 
-int demo_pretex_chunk_loaded(int cx, int cy) {
-	live_chunk* c = chunk_list;
-	while (c) {
-		if (c->cx == cx && c->cy == cy) return 1;
-		c = c->next;
+void demo_pretex_collect_chunks(void) {
+	/*
+	 * move finished tile data from the workers into the compile queue.
+	 * compilation is deferred to demo_pretex_compile_queued so it can be spread over frames.
+	 */
+
+	wpool_job* j;
+
+	while ((j = wpool_poll())) {
+		live_chunk* c = chunktab_find(&chunks, j->cx, j->cy);
+
+		if (!c || c->state != CHUNK_LOADING || j->gen != c->gen) {
+			wpool_release(j); /* culled while loading, or left over from before a cull */
+			continue;
+		}
+
+		if (cq_len == cq_cap) {
+			unsigned cap = cq_cap ? cq_cap * 2 : 64;
+			wpool_job** next = malloc(sizeof *next * cap);
+			if (!next) {
+				wpool_release(j);
+				chunktab_erase(&chunks, c);
+				continue;
+			}
+
+			for (unsigned i = 0; i < cq_len; ++i) {
+				next[i] = compile_queue[(cq_head + i) % cq_cap];
+			}
+
+			free(compile_queue);
+			compile_queue = next;
+			cq_cap = cap;
+			cq_head = 0;
+		}
+
+		c->state = CHUNK_QUEUED;
+		compile_queue[(cq_head + cq_len++) % cq_cap] = j;
+	}
+}
+
+void demo_pretex_compile_queued(void) {
+	/*
+	 * drain the compile queue until either budget runs out.
+	 * the first chunk is always compiled so the queue makes progress even with a tiny budget.
+	 * entries for chunks that were culled (or left over from a request before a cull) are dropped.
+	 */
+
+	tp start = timer_get();
+	unsigned draws = 0, cost = compile_instanced ? 1 : CHUNKSIZE * CHUNKSIZE;
+
+	while (cq_len) {
+		if (draws && compile_budget_ms > 0.0f && timer_diff(start) >= compile_budget_ms) break;
+		if (draws && compile_budget_draws && draws + cost > compile_budget_draws) break;
+
+		wpool_job* j = compile_queue[cq_head];
+		cq_head = (cq_head + 1) % cq_cap;
+		cq_len--;
+
+		live_chunk* c = chunktab_find(&chunks, j->cx, j->cy);
+
+		if (c && c->state == CHUNK_QUEUED && j->gen == c->gen) {
+			if (demo_pretex_compile_chunk(c, j->tiles)) {
+				chunktab_erase(&chunks, c);
+			} else {
+				draws += cost;
+			}
+		}
+
+		wpool_release(j);
+	}
+}
+
+static int demo_pretex_lru_cmp(const void* a, const void* b) {
+	unsigned ua = (*(live_chunk* const*) a)->last_used, ub = (*(live_chunk* const*) b)->last_used;
+	return ua < ub ? -1 : ua > ub;
+}
+
+void demo_pretex_evict(void) {
+	/* free the least recently used compiled chunks that aren't on screen until we're back under the limits */
+	unsigned limit = CACHE_CHUNKS;
+
+	if (CACHE_BYTES && (!limit || CACHE_BYTES / CHUNK_BYTES < limit)) limit = CACHE_BYTES / CHUNK_BYTES;
+	if (!limit || resident <= limit) return;
+
+	live_chunk** lru = malloc(sizeof *lru * resident);
+	live_chunk* c;
+	unsigned it = 0, n = 0;
+
+	if (!lru) return;
+
+	while ((c = chunktab_next(&chunks, &it))) {
+		if (c->state == CHUNK_READY && c->last_visible != frame_no) lru[n++] = c;
 	}
+
+	qsort(lru, n, sizeof *lru, demo_pretex_lru_cmp);
+
+	for (unsigned i = 0; i < n && resident > limit; ++i) {
+		demo_pretex_free_chunk(lru[i]);
+		total_evicts++;
+	}
+
+	free(lru);
+}
+
+int demo_pretex_pick_lod(void) {
+	/* the coarsest level that still has a texel for every pixel of a tile on screen */
+	float ppt = HEIGHT / camera[3];
+	int level = 0;
+
+	while (level < LOD_MAX && (BLOCKPIXELS >> (level + 1)) >= ppt) level++;
+	return level;
+}
+
+void demo_pretex_request_lods(void) {
+	/*
+	 * loads and bakes towards the visible super-chunks that aren't ready (or are stale after an edit).
+	 * only LOD_PATHS of them make progress at once, which bounds the children they pin
+	 */
+
+	int size = CHUNKSIZE << lod;
+	bakes = paths = 0;
+
+	for (int x = (int) camerax / size; x * size < camerax + camera[2]; ++x) {
+		if (x < 0) continue;
+		for (int y = (int) cameray / size; y * size < cameray + camera[3]; ++y) {
+			if (y < 0) continue;
+
+			live_chunk* c = chunktab_insert(lods + lod - 1, x, y);
+			if (!c) continue;
+
+			c->last_used = c->last_visible = frame_no;
+			if (c->state == CHUNK_READY && !c->stale) continue;
+
+			if (paths++ < LOD_PATHS) demo_pretex_need_lod(lod, x, y);
+		}
+	}
+}
+
+live_chunk* demo_pretex_need_lod(int level, int x, int y) {
+	if (!level) {
+		demo_pretex_request_chunk(x, y);
+
+		live_chunk* c = chunktab_find(&chunks, x, y);
+		if (!c) return NULL; /* workers are busy, try again next frame */
+
+		c->last_used = c->last_visible = frame_no; /* pinned until its parent is baked */
+		return c->state == CHUNK_READY ? c : NULL;
+	}
+
+	/* the children's tables are the only ones touched below, so c stays valid */
+	live_chunk* c = chunktab_insert(lods + level - 1, x, y);
+	if (!c) return NULL;
+
+	c->last_used = c->last_visible = frame_no;
+	if (c->state == CHUNK_READY && !c->stale) return c;
+
+	/* above level 1 the children are finished one at a time, a level 1 group loads all four chunks together */
+	int ready = 0;
+
+	for (int i = 0; i < 4; ++i) {
+		if (demo_pretex_need_lod(level - 1, x * 2 + i % 2, y * 2 + i / 2)) {
+			ready++;
+		} else if (level > 1) {
+			break;
+		}
+	}
+
+	if (ready < 4 || bakes >= LOD_BAKE_BUDGET) return NULL;
+	return demo_pretex_bake(c, level) ? NULL : c;
+}
+
+void demo_pretex_render_lods(void) {
+	int size = CHUNKSIZE << lod;
+
+	for (int x = (int) camerax / size; x * size < camerax + camera[2]; ++x) {
+		if (x < 0) continue;
+		for (int y = (int) cameray / size; y * size < cameray + camera[3]; ++y) {
+			if (y < 0) continue;
+			demo_pretex_draw_lod(lod, x, y);
+		}
+	}
+}
+
+void demo_pretex_draw_lod(int level, int x, int y) {
+	/*
+	 * a baked texture is drawn even when it's stale, otherwise whatever is ready a level down,
+	 * otherwise one placeholder for the whole super-chunk
+	 */
+
+	live_chunk* c = level ? chunktab_find(lods + level - 1, x, y) : chunktab_find(&chunks, x, y);
+	float size = CHUNKSIZE << level;
+
+	if (c && c->state == CHUNK_READY) {
+		c->last_visible = frame_no;
+		rc_count++;
+		demo_pretex_queue_inst(c->target.page, x * size, y * size, c->target.layer, 1 << level);
+		return;
+	}
+
+	int below = 0;
+
+	for (int i = 0; level && !c && !below && i < 4; ++i) {
+		int cx = x * 2 + i % 2, cy = y * 2 + i / 2;
+		below = (level > 1 ? chunktab_find(lods + level - 2, cx, cy) : chunktab_find(&chunks, cx, cy)) != NULL;
+	}
+
+	if (level && (c || below)) {
+		for (int i = 0; i < 4; ++i) demo_pretex_draw_lod(level - 1, x * 2 + i % 2, y * 2 + i / 2);
+		return;
+	}
+
+	rc_count++;
+	ph_count++;
+	demo_pretex_queue_inst(0, x * size, y * size, -1, 1 << level);
+}
+
+int demo_pretex_bake(live_chunk* c, int level) {
+	/*
+	 * blits the four children of a super-chunk into its quadrants at half their resolution,
+	 * linear filtering at exactly 2:1 averages each 2x2 block of child texels.
+	 * a blit between FBOs is defined even when a child is another layer of the same page,
+	 * sampling it in a shader while drawing into that page would be a feedback loop.
+	 * a rebake after an edit draws over the target it already has
+	 */
+
+	live_chunk* kids[4];
+
+	for (int i = 0; i < 4; ++i) {
+		int cx = c->cx * 2 + i % 2, cy = c->cy * 2 + i / 2;
+		kids[i] = level > 1 ? chunktab_find(lods + level - 2, cx, cy) : chunktab_find(&chunks, cx, cy);
+	}
+
+	if (c->state != CHUNK_READY) {
+		if (texpool_borrow(&c->target)) {
+			printf("demo_pretex: no render target for level %d super-chunk %d, %d\n", level, c->cx, c->cy);
+			return 1;
+		}
+
+		c->state = CHUNK_READY;
+		lod_resident[level - 1]++;
+	}
+
+	TIMER_ZONE_BEGIN_CHUNK("demo_pretex_bake", c->cx, c->cy);
+
+	int full = CHUNKSIZE * BLOCKPIXELS, half = full / 2;
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, c->target.fbo);
+
+	for (int i = 0; i < 4; ++i) {
+		int x = i % 2 * half, y = i / 2 * half;
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, kids[i]->target.fbo);
+		glBlitFramebuffer(0, 0, full, full, x, y, x + half, y + half, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, screen_fbo);
+
+	c->stale = 0;
+	bakes++;
+	total_bakes++;
+
+	TIMER_ZONE_END();
 	return 0;
 }
 
-void demo_pretex_request_chunk(int cx, int cy) {
-	if (demo_pretex_chunk_loaded(cx, cy)) return;
-	live_chunk* c = demo_pretex_compile_chunk(cx, cy);
-	if (chunk_list_tail) {
-		c->prev = chunk_list_tail;
-		chunk_list_tail->next = c;
-	} else {
-		chunk_list = c;
+void demo_pretex_free_lod(live_chunk* c, int level) {
+	if (c->state == CHUNK_READY) {
+		texpool_return(&c->target);
+		lod_resident[level - 1]--;
+	}
+
+	chunktab_erase(lods + level - 1, c);
+}
+
+void demo_pretex_evict_lods(void) {
+	/*
+	 * super-chunks still waiting on children are dropped as soon as nothing asks for them,
+	 * baked ones stay until their level is over LOD_CACHE_CHUNKS, least recently used first
+	 */
+
+	for (int l = 1; l <= LOD_MAX; ++l) {
+		chunktab* t = lods + l - 1;
+		live_chunk* c, **lru = NULL;
+		unsigned it = 0, n = 0;
+
+		if (lod_resident[l - 1] > LOD_CACHE_CHUNKS) lru = malloc(sizeof *lru * lod_resident[l - 1]);
+
+		while ((c = chunktab_next(t, &it))) {
+			if (c->state != CHUNK_READY) {
+				if (c->last_used != frame_no) demo_pretex_free_lod(c, l);
+			} else if (lru && c->last_visible != frame_no) {
+				lru[n++] = c;
+			}
+		}
+
+		if (!lru) continue;
+
+		qsort(lru, n, sizeof *lru, demo_pretex_lru_cmp);
+
+		for (unsigned i = 0; i < n && lod_resident[l - 1] > LOD_CACHE_CHUNKS; ++i) {
+			demo_pretex_free_lod(lru[i], l);
+			total_evicts++;
+		}
+
+		free(lru);
 	}
-	chunk_list_tail = c;
 }
 
 void demo_pretex_render_chunk_boundaries(void) {
-	/* render some lines around */
-	/* don't need much here */
-
-	glLineWidth(1.5f);
-	mat4x4_identity(model);
-	update_mats();
-
-	for (int cx = ((int) camerax / (int) CHUNKSIZE); cx*CHUNKSIZE < camerax+CAMERASIZE*RATIO; ++cx) {
-		float verts[] = { cx*CHUNKSIZE, cameray, 0.5f, 0.5f, cx*CHUNKSIZE, cameray+CAMERASIZE, 0.5f, 0.5f };
-		unsigned vao;
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float)*4, verts);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float)*4, verts+2);
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glBindTexture(GL_TEXTURE_2D, line_tex);
-		glDrawArrays(GL_LINES, 0, 2);
-	}
-
-	for (int cy = ((int) cameray / (int) CHUNKSIZE); cy*CHUNKSIZE < cameray+CAMERASIZE; ++cy) {
-		float verts[] = { camerax, cy*CHUNKSIZE, 0.5f, 0.5f, camerax+CAMERASIZE*RATIO, cy*CHUNKSIZE, 0.5f, 0.5f };
-		unsigned vao;
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float)*4, verts);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float)*4, verts+2);
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glBindTexture(GL_TEXTURE_2D, line_tex);
-		glDrawArrays(GL_LINES, 0, 2);
+	/* chunk edges, or super-chunk edges when zoomed out, from the grid shader or as batched lines (G toggles) */
+	int size = CHUNKSIZE << lod;
+
+	if (bounds_grid) {
+		dbgdraw_grid(size, 1.5f, col_bounds);
+	} else {
+		for (int cx = ((int) camerax / size); cx*size < camerax+camera[2]; ++cx) {
+			dbgdraw_line(cx*size, cameray, cx*size, cameray+camera[3], col_bounds);
+		}
+
+		for (int cy = ((int) cameray / size); cy*size < cameray+camera[3]; ++cy) {
+			dbgdraw_line(camerax, cy*size, camerax+camera[2], cy*size, col_bounds);
+		}
 	}
+
+	/* visible chunks still showing the placeholder */
+	live_chunk* c;
+	unsigned it = 0;
+
+	while ((c = chunktab_next(&chunks, &it))) {
+		if (c->state == CHUNK_READY || c->last_visible != frame_no) continue;
+
+		float x = c->cx * CHUNKSIZE, y = c->cy * CHUNKSIZE;
+		dbgdraw_rect(x + 0.5f, y + 0.5f, CHUNKSIZE - 1.0f, CHUNKSIZE - 1.0f, col_warn);
+		dbgdraw_cross(x + CHUNKSIZE / 2.0f, y + CHUNKSIZE / 2.0f, 4.0f, col_warn);
+	}
+
+	dbgdraw_flush();
+}
+
+int demo_pretex_key_pressed(int key) {
+	/* edge-triggered key check for toggles */
+	int down = glfwGetKey(wh, key) == GLFW_PRESS;
+	int pressed = down && !keys_down[key];
+	keys_down[key] = down;
+	return pressed;
 }
 
 unsigned demo_pretex_load_tex(const char* filename) {
-	int w, h, rw;
+	int w, h;
 	unsigned output;
-	unsigned char* stbd = stbi_load(filename, &w, &h, NULL, 4);
-	if (!stbd) {
-		printf("tex fail: %s\n", filename);
-		return 0;
-	}
-	unsigned char* next = malloc(w*h*4);
-	rw = 4*w;
-	for (int j = 0; j < h; ++j) {
-		memcpy(next + j * rw, stbd + (h-1) * rw - j*rw, rw);
-	}
+	unsigned char* next = blocks_load_image(filename, &w, &h);
+	if (!next) return 0;
+
 	glGenTextures(1, &output);
 	glBindTexture(GL_TEXTURE_2D, output);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, next);
 	free(next);
-	stbi_image_free(stbd);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	return output;
@@ -0,0 +1,261 @@
+#include "demo_tilemap.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include <GLXW/glxw.h>
+
+#include "tileproto.h"
+#include "defs.h"
+#include "text.h"
+#include "overlay.h"
+#include "timer.h"
+#include "wpool.h"
+#include "blocks.h"
+#include "world.h"
+#include "bench.h"
+
+#define FONTSIZE 21
+
+/* enough chunk slots to cover the view at any alignment */
+#define SLOTS_X ((int) CAMERASIZE * WIDTH / HEIGHT / CHUNKSIZE + 2)
+#define SLOTS_Y ((int) CAMERASIZE / CHUNKSIZE + 2)
+
+#define SLOT_EMPTY 0
+#define SLOT_WANTED 1 /* assigned, waiting for a free worker */
+#define SLOT_LOADING 2
+#define SLOT_READY 3
+
+typedef struct _tilemap_slot {
+	int cx, cy, state;
+} tilemap_slot;
+
+static unsigned tilemap_init = 0;
+static blocks bank;
+static tilemap_slot slots[SLOTS_X * SLOTS_Y];
+static unsigned tile_tex, quad_vbo, quad_vao, tilemap_prg, loc_tiles, loc_blocks;
+static float fps;
+static unsigned fps_count, up_count;
+static tp fps_tp;
+
+static tk_font* dbg_font;
+static overlay* hud;
+static const float col_warn[4] = { 1.0f, 0.5f, 0.0f, 1.0f };
+
+/*
+ * the whole view is one quad. the fragment shader finds the tile under each pixel
+ * in a toroidal window of raw tile ids and samples the block texture array directly
+ */
+static const char* tilemap_vs = "#version 330\n"
+			CAMERA_BLOCK
+			"layout(location = 0) in vec2 position;\n"
+			"out vec2 world;\n"
+			"void main(void) {\n"
+			"	gl_Position = vec4(position, 0.0, 1.0);\n"
+			"	world = view.xy + (position * 0.5 + 0.5) * view.zw;\n"
+			"}\n";
+
+static const char* tilemap_fs = "#version 330\n"
+			"uniform usampler2D tiles;\n"
+			"uniform sampler2DArray blocks;\n"
+			"in vec2 world;\n"
+			"out vec4 color;\n"
+			"void main(void) {\n"
+			"	ivec2 tile = ivec2(floor(world));\n"
+			"	if (tile.x < 0 || tile.y < 0) discard;\n"
+			"	uint id = texelFetch(tiles, tile % textureSize(tiles, 0), 0).r;\n"
+			"	color = texture(blocks, vec3(fract(world), float(id)));\n"
+			"}\n";
+
+void demo_tilemap_prepare_chunk(wpool_job* job); /* worker thread */
+void demo_tilemap_request_chunk(int cx, int cy);
+void demo_tilemap_upload(tilemap_slot* s, const tile_t* data);
+tilemap_slot* demo_tilemap_slot(int cx, int cy);
+
+int demo_tilemap_render(void) {
+	if (!tilemap_init) {
+		int r = demo_tilemap_init();
+		if (r) return r;
+	}
+
+	/*
+	 * no pretexturing at all: chunks only cost a CHUNKSIZE^2 byte upload when they come into view,
+	 * and the per-frame cost is a single fullscreen draw no matter how many chunks are visible
+	 */
+
+	camera_update();
+
+	for (int cx = ((int) camerax / (int) CHUNKSIZE); cx * CHUNKSIZE < camerax + CAMERASIZE*RATIO; ++cx) {
+		if (cx < 0) continue;
+		for (int cy = ((int) cameray / (int) CHUNKSIZE); cy * CHUNKSIZE < cameray + CAMERASIZE; ++cy) {
+			if (cy < 0) continue;
+			demo_tilemap_request_chunk(cx, cy);
+		}
+	}
+
+	wpool_job* j;
+
+	while ((j = wpool_poll())) {
+		tilemap_slot* s = demo_tilemap_slot(j->cx, j->cy);
+
+		/* the slot may have been handed to another chunk while this one was loading */
+		if (s->state == SLOT_LOADING && s->cx == j->cx && s->cy == j->cy) {
+			demo_tilemap_upload(s, j->tiles);
+			s->state = SLOT_READY;
+			up_count++;
+		}
+
+		wpool_release(j);
+	}
+
+	glUseProgram(tilemap_prg);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, tile_tex);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, bank.tex);
+
+	glBindVertexArray(quad_vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	fps_count++;
+
+	const int g = 4;
+
+	if (timer_diff(fps_tp) >= 1000.0f / g) {
+		fps = fps_count / (timer_diff(fps_tp) / 1000.0f);
+		fps_tp = timer_get();
+		fps_count = 0;
+	}
+
+	const float* col_fps = fps < 60 ? col_warn : NULL;
+
+	/* pretex would keep one RGBA texture per resident chunk instead of one id per tile */
+	int tile_kb = SLOTS_X * SLOTS_Y * CHUNKSIZE * CHUNKSIZE * sizeof(tile_t) / 1024;
+	int pretex_kb = SLOTS_X * SLOTS_Y * CHUNKSIZE * CHUNKSIZE * BLOCKPIXELS * BLOCKPIXELS * 4 / 1024;
+
+	overlay_begin(hud);
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - 25, 0, "Tilemap shader demo");
+	overlay_text(hud, dbg_font, col_fps, 10, HEIGHT - FONTSIZE - 25, 0, "FPS [g=%d]: %.2f\n", g, fps);
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - FONTSIZE*2 - 25, 0, "chunksize=%d ppb=%d blocks=%d cx=%.2f cy=%.2f |cvel|=%.2f", CHUNKSIZE, BLOCKPIXELS, bank.count, camerax, cameray, sqrt(cxspeed*cxspeed+cyspeed*cyspeed));
+	overlay_text(hud, dbg_font, NULL, 10, HEIGHT - FONTSIZE*3 - 25, 0, "uploaded %d, loading %d, tile ids %d KB (pretex equivalent %d KB)", up_count, wpool_pending(), tile_kb, pretex_kb);
+	overlay_text(hud, dbg_font, NULL, 10, 10, 0, "controls: arrow keys to move");
+	overlay_end(hud);
+
+	bench_compiles(up_count);
+	up_count = 0;
+	return 0;
+}
+
+int demo_tilemap_init(void) {
+	tilemap_init = 1;
+	printf("demo_tilemap: initializing\n");
+	printf("demo_tilemap: %dx%d chunk window, chunk size = %dx%d blocks\n", SLOTS_X, SLOTS_Y, CHUNKSIZE, CHUNKSIZE);
+
+	fps_tp = timer_get();
+
+	if (blocks_load(&bank, opt_blockdir, BLOCKPIXELS)) return 1;
+	world_init(bank.count);
+
+	if (wpool_init(opt_workers, CHUNKSIZE * CHUNKSIZE * sizeof(tile_t), demo_tilemap_prepare_chunk)) return 1;
+
+	/* raw tile ids for every slot, starting out as empty blocks */
+	tile_t* zero = calloc(SLOTS_X * SLOTS_Y, CHUNKSIZE * CHUNKSIZE * sizeof(tile_t));
+
+	glGenTextures(1, &tile_tex);
+	glBindTexture(GL_TEXTURE_2D, tile_tex);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, SLOTS_X * CHUNKSIZE, SLOTS_Y * CHUNKSIZE, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, zero);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	free(zero);
+
+	float verts[] = {
+		-1.0f, -1.0f,
+		1.0f, -1.0f,
+		-1.0f, 1.0f,
+		1.0f, 1.0f,
+	};
+
+	glGenVertexArrays(1, &quad_vao);
+	glBindVertexArray(quad_vao);
+	glGenBuffers(1, &quad_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof verts, verts, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float)*2, NULL);
+	glEnableVertexAttribArray(0);
+
+	tilemap_prg = make_program(tilemap_vs, tilemap_fs);
+	if (!tilemap_prg) return 1;
+
+	glUseProgram(tilemap_prg);
+	loc_tiles = glGetUniformLocation(tilemap_prg, "tiles");
+	loc_blocks = glGetUniformLocation(tilemap_prg, "blocks");
+	glUniform1i(loc_blocks, 0);
+	glUniform1i(loc_tiles, 1);
+	glUseProgram(prg);
+
+	dbg_font = tk_font_init("res/debug.ttf", FONTSIZE);
+
+	hud = overlay_create(WIDTH, HEIGHT, opt_hud_rate);
+	if (!hud) return 1;
+
+	return 0;
+}
+
+void demo_tilemap_free(void) {
+	if (!tilemap_init) return;
+	printf("demo_tilemap: cleaning up\n");
+
+	wpool_free();
+
+	glDeleteTextures(1, &tile_tex);
+	glDeleteBuffers(1, &quad_vbo);
+	glDeleteVertexArrays(1, &quad_vao);
+	glDeleteProgram(tilemap_prg);
+	blocks_free(&bank);
+
+	tk_font_free(dbg_font);
+	dbg_font = NULL;
+
+	overlay_free(hud);
+	hud = NULL;
+}
+
+void demo_tilemap_prepare_chunk(wpool_job* job) {
+	job->tiles = world_query(job->cx, job->cy, (tile_t*) job->data);
+}
+
+void demo_tilemap_request_chunk(int cx, int cy) {
+	tilemap_slot* s = demo_tilemap_slot(cx, cy);
+
+	if (s->state == SLOT_EMPTY || s->cx != cx || s->cy != cy) {
+		/* evict whatever used to live here so it can't show through while loading */
+		s->cx = cx;
+		s->cy = cy;
+		s->state = SLOT_WANTED;
+
+		tile_t zero[CHUNKSIZE * CHUNKSIZE] = {0};
+		demo_tilemap_upload(s, zero);
+	}
+
+	if (s->state == SLOT_WANTED && !wpool_submit(cx, cy, 0)) s->state = SLOT_LOADING;
+}
+
+void demo_tilemap_upload(tilemap_slot* s, const tile_t* data) {
+	int sx = s->cx % SLOTS_X, sy = s->cy % SLOTS_Y;
+
+	glBindTexture(GL_TEXTURE_2D, tile_tex);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, sx * CHUNKSIZE, sy * CHUNKSIZE, CHUNKSIZE, CHUNKSIZE, GL_RED_INTEGER, GL_UNSIGNED_SHORT, data);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+tilemap_slot* demo_tilemap_slot(int cx, int cy) {
+	/* only non-negative chunks are ever requested, same as the pretex demo */
+	return slots + (cx % SLOTS_X) + (cy % SLOTS_Y) * SLOTS_X;
+}
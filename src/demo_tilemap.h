@@ -0,0 +1,5 @@
+#pragma once
+
+int demo_tilemap_render(void);
+int demo_tilemap_init(void); /* automatically called. don't bother */
+void demo_tilemap_free(void); /* please call afterwards */
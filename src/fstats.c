@@ -0,0 +1,190 @@
+#include "fstats.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <GLXW/glxw.h>
+
+#include "tileproto.h"
+
+static uint32_t hist[FSTATS_BUCKETS];
+static unsigned hist_count;
+static uint32_t hist_max;
+
+static float ring[FSTATS_RING];
+static unsigned ring_next, ring_len;
+
+static float* log_ms;
+static unsigned log_len, log_cap;
+
+static unsigned graph_vao, graph_vbo, graph_prg, loc_graph_rect, loc_graph_scale, loc_graph_count;
+
+/* x comes from the vertex index so only the frame times are uploaded, colour goes by frame budget */
+static const char* fstats_graph_vs = "#version 330\n"
+			"layout(location = 0) in float ms;\n"
+			"uniform vec4 rect;\n"
+			"uniform float scale;\n"
+			"uniform int count;\n"
+			"out vec3 col;\n"
+			"void main(void) {\n"
+			"	vec2 p = vec2(float(gl_VertexID) / float(max(count - 1, 1)), min(ms / scale, 1.0));\n"
+			"	gl_Position = vec4(rect.xy + p * rect.zw, 0.0, 1.0);\n"
+			"	col = ms < 16.7 ? vec3(0.3, 1.0, 0.3) : ms < 33.3 ? vec3(1.0, 0.5, 0.0) : vec3(1.0, 0.2, 0.0);\n"
+			"}\n";
+
+static const char* fstats_graph_fs = "#version 330\n"
+			"in vec3 col;\n"
+			"out vec4 color;\n"
+			"void main(void) {\n"
+			"	color = vec4(col, 1.0);\n"
+			"}\n";
+
+static unsigned fstats_bucket(uint32_t us);
+static uint32_t fstats_bucket_value(unsigned b);
+
+int fstats_init(void) {
+	graph_prg = make_program(fstats_graph_vs, fstats_graph_fs);
+	if (!graph_prg) return 1;
+
+	loc_graph_rect = glGetUniformLocation(graph_prg, "rect");
+	loc_graph_scale = glGetUniformLocation(graph_prg, "scale");
+	loc_graph_count = glGetUniformLocation(graph_prg, "count");
+
+	glGenVertexArrays(1, &graph_vao);
+	glBindVertexArray(graph_vao);
+	glGenBuffers(1, &graph_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, graph_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof ring, NULL, GL_STREAM_DRAW);
+
+	glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 0, NULL);
+	glEnableVertexAttribArray(0);
+
+	return 0;
+}
+
+void fstats_free(void) {
+	glDeleteBuffers(1, &graph_vbo);
+	glDeleteVertexArrays(1, &graph_vao);
+	glDeleteProgram(graph_prg);
+
+	free(log_ms);
+	log_ms = NULL;
+	log_len = log_cap = 0;
+	ring_next = ring_len = 0;
+	fstats_reset();
+}
+
+void fstats_frame(float ms) {
+	ring[ring_next] = ms;
+	ring_next = (ring_next + 1) % FSTATS_RING;
+	if (ring_len < FSTATS_RING) ring_len++;
+
+	uint32_t us = ms > 0.0f ? ms * 1000.0f : 0;
+	hist[fstats_bucket(us)]++;
+	hist_count++;
+	if (us > hist_max) hist_max = us;
+
+	if (log_len == log_cap) {
+		unsigned cap = log_cap ? log_cap * 2 : 4096;
+		float* next = realloc(log_ms, sizeof *next * cap);
+		if (!next) return;
+		log_ms = next;
+		log_cap = cap;
+	}
+
+	log_ms[log_len++] = ms;
+}
+
+void fstats_reset(void) {
+	memset(hist, 0, sizeof hist);
+	hist_count = hist_max = 0;
+}
+
+float fstats_percentile(float p) {
+	if (!hist_count) return 0.0f;
+
+	/* nearest rank, reported as the middle of the bucket it falls in */
+	unsigned rank = p / 100.0f * hist_count + 0.5f, seen = 0;
+	if (!rank) rank = 1;
+
+	for (unsigned b = 0; b < FSTATS_BUCKETS; ++b) {
+		seen += hist[b];
+		if (seen >= rank) {
+			uint32_t v = (fstats_bucket_value(b) + fstats_bucket_value(b + 1)) / 2;
+			return (v < hist_max ? v : hist_max) / 1000.0f;
+		}
+	}
+
+	return hist_max / 1000.0f;
+}
+
+float fstats_max(void) {
+	return hist_max / 1000.0f;
+}
+
+unsigned fstats_count(void) {
+	return hist_count;
+}
+
+void fstats_draw_graph(float x, float y, float w, float h, float scale_ms) {
+	if (!ring_len) return;
+
+	/* oldest first, so the newest frame is always at the right edge */
+	float ordered[FSTATS_RING];
+	unsigned start = (ring_next + FSTATS_RING - ring_len) % FSTATS_RING;
+
+	for (unsigned i = 0; i < ring_len; ++i) ordered[i] = ring[(start + i) % FSTATS_RING];
+
+	glUseProgram(graph_prg);
+	glUniform4f(loc_graph_rect, x / WIDTH * 2.0f - 1.0f, y / HEIGHT * 2.0f - 1.0f, w / WIDTH * 2.0f, h / HEIGHT * 2.0f);
+	glUniform1f(loc_graph_scale, scale_ms);
+	glUniform1i(loc_graph_count, ring_len); /* spread over the width, the newest point lands on the right edge */
+
+	glBindVertexArray(graph_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, graph_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof ring, NULL, GL_STREAM_DRAW); /* orphan last frame's copy */
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * ring_len, ordered);
+
+	glDrawArrays(GL_LINE_STRIP, 0, ring_len);
+
+	glUseProgram(prg);
+}
+
+int fstats_dump_csv(const char* filename) {
+	FILE* f = fopen(filename, "w");
+	if (!f) {
+		printf("fstats: can't write %s\n", filename);
+		return 1;
+	}
+
+	fprintf(f, "frame,ms\n");
+	for (unsigned i = 0; i < log_len; ++i) fprintf(f, "%u,%.4f\n", i, log_ms[i]);
+
+	fclose(f);
+	printf("fstats: wrote %u frames to %s (p50 %.2f, p95 %.2f, p99 %.2f, max %.2f ms)\n", log_len, filename, fstats_percentile(50.0f), fstats_percentile(95.0f), fstats_percentile(99.0f), fstats_max());
+	return 0;
+}
+
+unsigned fstats_bucket(uint32_t us) {
+	/*
+	 * log-linear: values below 2^(SUB_BITS+1) get a bucket each, above that every
+	 * power of two is split into 2^SUB_BITS equal buckets
+	 */
+
+	if (us >> 26) us = (1u << 26) - 1;
+
+	unsigned e = 0;
+	while (us >> (e + FSTATS_SUB_BITS + 1)) e++;
+
+	return (e << FSTATS_SUB_BITS) + (us >> e);
+}
+
+uint32_t fstats_bucket_value(unsigned b) {
+	/* lowest value that lands in bucket b */
+	if (b < 2u << FSTATS_SUB_BITS) return b;
+
+	unsigned e = (b >> FSTATS_SUB_BITS) - 1;
+	return (uint32_t) (b - (e << FSTATS_SUB_BITS)) << e;
+}
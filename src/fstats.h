@@ -0,0 +1,28 @@
+#pragma once
+
+/*
+ * fstats
+ *
+ * per-frame timing. every frame time goes into a ring (for the on-screen graph), an
+ * HDR-style log-linear histogram (for percentiles over the whole run at ~3% precision
+ * with constant memory) and a growable log (for the CSV dump).
+ */
+
+#define FSTATS_RING 512 /* frames shown in the graph */
+#define FSTATS_SUB_BITS 5 /* 32 linear sub-buckets per power of two */
+#define FSTATS_BUCKETS ((26 - FSTATS_SUB_BITS + 1) << FSTATS_SUB_BITS) /* covers up to 2^26 us */
+
+int fstats_init(void); /* sets up the graph's GL objects */
+void fstats_free(void);
+
+void fstats_frame(float ms);
+void fstats_reset(void); /* clears the histogram, the ring and the log are kept */
+
+float fstats_percentile(float p); /* ms, p in [0, 100] */
+float fstats_max(void); /* ms */
+unsigned fstats_count(void);
+
+/* frame times of the last FSTATS_RING frames as one line strip. x, y, w, h in pixels from the lower left, scale_ms at the top */
+void fstats_draw_graph(float x, float y, float w, float h, float scale_ms);
+
+int fstats_dump_csv(const char* filename); /* every recorded frame, in order */
@@ -0,0 +1,123 @@
+#include "gpuprof.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <GLXW/glxw.h>
+
+#include "timer.h"
+#include "bench.h"
+
+#define GPUPROF_SMOOTH 0.1f /* weight of the newest sample */
+
+typedef struct _gpuprof_slot {
+	unsigned queries[GPU_PHASES][2]; /* begin, end timestamps */
+	float cpu_ms[GPU_PHASES];
+	tp cpu_begin[GPU_PHASES];
+	int issued[GPU_PHASES];
+} gpuprof_slot;
+
+static const char* names[GPU_PHASES] = { "compile", "world", "bounds", "hud" };
+
+static gpuprof_slot slots[GPUPROF_FRAMES];
+static int cur, enabled;
+static float gpu_avg[GPU_PHASES], cpu_avg[GPU_PHASES];
+static unsigned dropped;
+
+static void gpuprof_collect(gpuprof_slot* s);
+
+int gpuprof_init(void) {
+	int bits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+
+	if (!bits) {
+		printf("gpuprof: no timestamp counter, gpu times will read 0\n");
+		return 0;
+	}
+
+	for (int i = 0; i < GPUPROF_FRAMES; ++i) {
+		glGenQueries(GPU_PHASES * 2, &slots[i].queries[0][0]);
+	}
+
+	enabled = 1;
+	return 0;
+}
+
+void gpuprof_free(void) {
+	if (!enabled) return;
+
+	for (int i = 0; i < GPUPROF_FRAMES; ++i) {
+		glDeleteQueries(GPU_PHASES * 2, &slots[i].queries[0][0]);
+	}
+
+	if (dropped) printf("gpuprof: %u phase results weren't ready in time and were dropped\n", dropped);
+
+	memset(slots, 0, sizeof slots);
+	memset(gpu_avg, 0, sizeof gpu_avg);
+	memset(cpu_avg, 0, sizeof cpu_avg);
+	enabled = 0;
+	dropped = 0;
+}
+
+void gpuprof_frame(void) {
+	if (!enabled) return;
+
+	/* the slot we're about to reuse was issued GPUPROF_FRAMES - 1 frames ago */
+	cur = (cur + 1) % GPUPROF_FRAMES;
+	gpuprof_collect(slots + cur);
+}
+
+void gpuprof_begin(int phase) {
+	if (!enabled) return;
+
+	gpuprof_slot* s = slots + cur;
+	glQueryCounter(s->queries[phase][0], GL_TIMESTAMP);
+	s->cpu_begin[phase] = timer_get();
+}
+
+void gpuprof_end(int phase) {
+	if (!enabled) return;
+
+	gpuprof_slot* s = slots + cur;
+	s->cpu_ms[phase] = timer_diff(s->cpu_begin[phase]);
+	glQueryCounter(s->queries[phase][1], GL_TIMESTAMP);
+	s->issued[phase] = 1;
+}
+
+const char* gpuprof_name(int phase) {
+	return names[phase];
+}
+
+float gpuprof_gpu_ms(int phase) {
+	return gpu_avg[phase];
+}
+
+float gpuprof_cpu_ms(int phase) {
+	return cpu_avg[phase];
+}
+
+void gpuprof_collect(gpuprof_slot* s) {
+	for (int p = 0; p < GPU_PHASES; ++p) {
+		if (!s->issued[p]) continue;
+		s->issued[p] = 0;
+
+		int ready = 0;
+		glGetQueryObjectiv(s->queries[p][1], GL_QUERY_RESULT_AVAILABLE, &ready);
+
+		if (!ready) {
+			dropped++; /* reissuing the query just replaces the result, never wait on it */
+			continue;
+		}
+
+		GLuint64 t0, t1;
+		glGetQueryObjectui64v(s->queries[p][0], GL_QUERY_RESULT, &t0);
+		glGetQueryObjectui64v(s->queries[p][1], GL_QUERY_RESULT, &t1);
+
+		float gpu = (t1 - t0) / 1000000.0f;
+
+		gpu_avg[p] += (gpu - gpu_avg[p]) * GPUPROF_SMOOTH;
+		cpu_avg[p] += (s->cpu_ms[p] - cpu_avg[p]) * GPUPROF_SMOOTH;
+
+		bench_phase(p, names[p], s->cpu_ms[p], gpu);
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+/*
+ * gpuprof
+ *
+ * per-phase GPU timing with GL_TIMESTAMP queries, next to CPU time for the same span.
+ * queries live in a ring GPUPROF_FRAMES deep and a frame's results are only read back
+ * when its slot comes around again, by which point the GPU is long done with it,
+ * so reading them never stalls the pipeline.
+ */
+
+#define GPUPROF_FRAMES 4 /* frames of queries in flight */
+
+enum {
+	GPU_COMPILE, /* chunk compiles */
+	GPU_WORLD, /* drawing live chunks */
+	GPU_BOUNDS, /* chunk boundary overlay */
+	GPU_HUD, /* text and graphs */
+	GPU_PHASES
+};
+
+int gpuprof_init(void);
+void gpuprof_free(void);
+
+void gpuprof_frame(void); /* once at the start of every frame, collects the oldest frame's results */
+void gpuprof_begin(int phase);
+void gpuprof_end(int phase);
+
+const char* gpuprof_name(int phase);
+float gpuprof_gpu_ms(int phase); /* smoothed */
+float gpuprof_cpu_ms(int phase); /* smoothed, same frames as the gpu value */
@@ -3,6 +3,40 @@
 
 #include <math.h>
 
+/*
+ * SIMD paths for the hot kernels (mat4x4_mul, mat4x4_mul_vec4 and the batch transforms),
+ * picked at compile time from the target flags: SSE2 on any x86-64, AVX on top of it with
+ * -mavx, NEON on ARM. define LINMATH_NO_SIMD for the plain loops. the vector code does the
+ * same multiplies and adds in the same order as the *_scalar versions and never fuses them,
+ * so results match bit for bit (up to the sign of zero). --bench-linmath checks this
+ */
+#if !defined(LINMATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define LINMATH_SSE2
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define LINMATH_AVX
+#include <immintrin.h>
+#endif
+#elif !defined(LINMATH_NO_SIMD) && defined(__ARM_NEON)
+#define LINMATH_NEON
+#include <arm_neon.h>
+#endif
+
+static inline const char* linmath_simd(void)
+{
+#if defined(LINMATH_AVX)
+	return "avx";
+#elif defined(LINMATH_SSE2)
+	return "sse2";
+#elif defined(LINMATH_NEON)
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
+
+typedef float vec2[2];
+
 typedef float vec3[3];
 static inline void vec3_add(vec3 r, vec3 const a, vec3 const b)
 {
@@ -166,7 +200,7 @@ static inline void mat4x4_scale_aniso(mat4x4 M, mat4x4 a, float x, float y, floa
 		M[3][i] = a[3][i];
 	}
 }
-static inline void mat4x4_mul(mat4x4 M, mat4x4 a, mat4x4 b)
+static inline void mat4x4_mul_scalar(mat4x4 M, mat4x4 a, mat4x4 b)
 {
 	int k, r, c;
 	for(c=0; c<4; ++c) for(r=0; r<4; ++r) {
@@ -175,7 +209,7 @@ static inline void mat4x4_mul(mat4x4 M, mat4x4 a, mat4x4 b)
 			M[c][r] += a[k][r] * b[c][k];
 	}
 }
-static inline void mat4x4_mul_vec4(vec4 r, mat4x4 M, vec4 v)
+static inline void mat4x4_mul_vec4_scalar(vec4 r, mat4x4 M, vec4 v)
 {
 	int i, j;
 	for(j=0; j<4; ++j) {
@@ -184,6 +218,156 @@ static inline void mat4x4_mul_vec4(vec4 r, mat4x4 M, vec4 v)
 			r[j] += M[i][j] * v[i];
 	}
 }
+static inline void mat4x4_mul_vec4_batch_scalar(vec4* r, mat4x4 M, vec4 const* v, int n)
+{
+	int i;
+	for(i=0; i<n; ++i) {
+		vec4 t = {v[i][0], v[i][1], v[i][2], v[i][3]};
+		mat4x4_mul_vec4_scalar(r[i], M, t);
+	}
+}
+static inline void mat4x4_mul_vec2_batch_scalar(vec2* r, mat4x4 M, vec2 const* v, int n)
+{
+	int i;
+	for(i=0; i<n; ++i) {
+		float x = v[i][0], y = v[i][1];
+		r[i][0] = M[0][0] * x + M[1][0] * y + M[3][0];
+		r[i][1] = M[0][1] * x + M[1][1] * y + M[3][1];
+	}
+}
+
+/* columns are loaded before anything is stored, so M may alias a or b */
+static inline void mat4x4_mul(mat4x4 M, mat4x4 a, mat4x4 b)
+{
+#if defined(LINMATH_SSE2)
+	__m128 a0 = _mm_loadu_ps(a[0]), a1 = _mm_loadu_ps(a[1]), a2 = _mm_loadu_ps(a[2]), a3 = _mm_loadu_ps(a[3]);
+	__m128 r[4];
+	int c;
+	for(c=0; c<4; ++c) {
+		r[c] = _mm_mul_ps(a0, _mm_set1_ps(b[c][0]));
+		r[c] = _mm_add_ps(r[c], _mm_mul_ps(a1, _mm_set1_ps(b[c][1])));
+		r[c] = _mm_add_ps(r[c], _mm_mul_ps(a2, _mm_set1_ps(b[c][2])));
+		r[c] = _mm_add_ps(r[c], _mm_mul_ps(a3, _mm_set1_ps(b[c][3])));
+	}
+	for(c=0; c<4; ++c)
+		_mm_storeu_ps(M[c], r[c]);
+#elif defined(LINMATH_NEON)
+	float32x4_t a0 = vld1q_f32(a[0]), a1 = vld1q_f32(a[1]), a2 = vld1q_f32(a[2]), a3 = vld1q_f32(a[3]);
+	float32x4_t r[4];
+	int c;
+	for(c=0; c<4; ++c) {
+		r[c] = vmulq_n_f32(a0, b[c][0]);
+		r[c] = vaddq_f32(r[c], vmulq_n_f32(a1, b[c][1]));
+		r[c] = vaddq_f32(r[c], vmulq_n_f32(a2, b[c][2]));
+		r[c] = vaddq_f32(r[c], vmulq_n_f32(a3, b[c][3]));
+	}
+	for(c=0; c<4; ++c)
+		vst1q_f32(M[c], r[c]);
+#else
+	mat4x4 t;
+	mat4x4_mul_scalar(t, a, b);
+	mat4x4_dup(M, t);
+#endif
+}
+static inline void mat4x4_mul_vec4(vec4 r, mat4x4 M, vec4 v)
+{
+#if defined(LINMATH_SSE2)
+	__m128 t = _mm_mul_ps(_mm_loadu_ps(M[0]), _mm_set1_ps(v[0]));
+	t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(M[1]), _mm_set1_ps(v[1])));
+	t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(M[2]), _mm_set1_ps(v[2])));
+	t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(M[3]), _mm_set1_ps(v[3])));
+	_mm_storeu_ps(r, t);
+#elif defined(LINMATH_NEON)
+	float32x4_t t = vmulq_n_f32(vld1q_f32(M[0]), v[0]);
+	t = vaddq_f32(t, vmulq_n_f32(vld1q_f32(M[1]), v[1]));
+	t = vaddq_f32(t, vmulq_n_f32(vld1q_f32(M[2]), v[2]));
+	t = vaddq_f32(t, vmulq_n_f32(vld1q_f32(M[3]), v[3]));
+	vst1q_f32(r, t);
+#else
+	vec4 t = {v[0], v[1], v[2], v[3]};
+	mat4x4_mul_vec4_scalar(r, M, t);
+#endif
+}
+
+/* r[i] = M * v[i] for n points, r may be v */
+static inline void mat4x4_mul_vec4_batch(vec4* r, mat4x4 M, vec4 const* v, int n)
+{
+	int i = 0;
+#if defined(LINMATH_AVX)
+	/* two points per register, each 128-bit lane gets its own point and a copy of every column */
+	__m256 c0 = _mm256_broadcast_ps((__m128 const*) M[0]), c1 = _mm256_broadcast_ps((__m128 const*) M[1]);
+	__m256 c2 = _mm256_broadcast_ps((__m128 const*) M[2]), c3 = _mm256_broadcast_ps((__m128 const*) M[3]);
+	for(; i+2<=n; i+=2) {
+		__m256 p = _mm256_loadu_ps(v[i]);
+		__m256 t = _mm256_mul_ps(c0, _mm256_permute_ps(p, 0x00));
+		t = _mm256_add_ps(t, _mm256_mul_ps(c1, _mm256_permute_ps(p, 0x55)));
+		t = _mm256_add_ps(t, _mm256_mul_ps(c2, _mm256_permute_ps(p, 0xaa)));
+		t = _mm256_add_ps(t, _mm256_mul_ps(c3, _mm256_permute_ps(p, 0xff)));
+		_mm256_storeu_ps(r[i], t);
+	}
+#endif
+#if defined(LINMATH_SSE2)
+	__m128 m0 = _mm_loadu_ps(M[0]), m1 = _mm_loadu_ps(M[1]), m2 = _mm_loadu_ps(M[2]), m3 = _mm_loadu_ps(M[3]);
+	for(; i<n; ++i) {
+		__m128 p = _mm_loadu_ps(v[i]);
+		__m128 t = _mm_mul_ps(m0, _mm_shuffle_ps(p, p, 0x00));
+		t = _mm_add_ps(t, _mm_mul_ps(m1, _mm_shuffle_ps(p, p, 0x55)));
+		t = _mm_add_ps(t, _mm_mul_ps(m2, _mm_shuffle_ps(p, p, 0xaa)));
+		t = _mm_add_ps(t, _mm_mul_ps(m3, _mm_shuffle_ps(p, p, 0xff)));
+		_mm_storeu_ps(r[i], t);
+	}
+#elif defined(LINMATH_NEON)
+	float32x4_t m0 = vld1q_f32(M[0]), m1 = vld1q_f32(M[1]), m2 = vld1q_f32(M[2]), m3 = vld1q_f32(M[3]);
+	for(; i<n; ++i) {
+		float32x4_t t = vmulq_n_f32(m0, v[i][0]);
+		t = vaddq_f32(t, vmulq_n_f32(m1, v[i][1]));
+		t = vaddq_f32(t, vmulq_n_f32(m2, v[i][2]));
+		t = vaddq_f32(t, vmulq_n_f32(m3, v[i][3]));
+		vst1q_f32(r[i], t);
+	}
+#else
+	mat4x4_mul_vec4_batch_scalar(r + i, M, v + i, n - i);
+#endif
+}
+
+/* 2D points taken as (x, y, 0, 1), only x and y of the result are written. r may be v */
+static inline void mat4x4_mul_vec2_batch(vec2* r, mat4x4 M, vec2 const* v, int n)
+{
+	int i = 0;
+#if defined(LINMATH_AVX)
+	/* four interleaved points per register */
+	__m256 cx = _mm256_setr_ps(M[0][0], M[0][1], M[0][0], M[0][1], M[0][0], M[0][1], M[0][0], M[0][1]);
+	__m256 cy = _mm256_setr_ps(M[1][0], M[1][1], M[1][0], M[1][1], M[1][0], M[1][1], M[1][0], M[1][1]);
+	__m256 cw = _mm256_setr_ps(M[3][0], M[3][1], M[3][0], M[3][1], M[3][0], M[3][1], M[3][0], M[3][1]);
+	for(; i+4<=n; i+=4) {
+		__m256 p = _mm256_loadu_ps(v[i]);
+		__m256 t = _mm256_mul_ps(cx, _mm256_permute_ps(p, 0xa0));
+		t = _mm256_add_ps(t, _mm256_mul_ps(cy, _mm256_permute_ps(p, 0xf5)));
+		_mm256_storeu_ps(r[i], _mm256_add_ps(t, cw));
+	}
+#endif
+#if defined(LINMATH_SSE2)
+	__m128 sx = _mm_setr_ps(M[0][0], M[0][1], M[0][0], M[0][1]);
+	__m128 sy = _mm_setr_ps(M[1][0], M[1][1], M[1][0], M[1][1]);
+	__m128 sw = _mm_setr_ps(M[3][0], M[3][1], M[3][0], M[3][1]);
+	for(; i+2<=n; i+=2) {
+		__m128 p = _mm_loadu_ps(v[i]);
+		__m128 t = _mm_mul_ps(sx, _mm_shuffle_ps(p, p, 0xa0));
+		t = _mm_add_ps(t, _mm_mul_ps(sy, _mm_shuffle_ps(p, p, 0xf5)));
+		_mm_storeu_ps(r[i], _mm_add_ps(t, sw));
+	}
+#elif defined(LINMATH_NEON)
+	/* four points deinterleaved into an x and a y register */
+	float32x4_t nw0 = vdupq_n_f32(M[3][0]), nw1 = vdupq_n_f32(M[3][1]);
+	for(; i+4<=n; i+=4) {
+		float32x4x2_t p = vld2q_f32(v[i]), t;
+		t.val[0] = vaddq_f32(vaddq_f32(vmulq_n_f32(p.val[0], M[0][0]), vmulq_n_f32(p.val[1], M[1][0])), nw0);
+		t.val[1] = vaddq_f32(vaddq_f32(vmulq_n_f32(p.val[0], M[0][1]), vmulq_n_f32(p.val[1], M[1][1])), nw1);
+		vst2q_f32(r[i], t);
+	}
+#endif
+	mat4x4_mul_vec2_batch_scalar(r + i, M, v + i, n - i);
+}
 static inline void mat4x4_translate(mat4x4 T, float x, float y, float z)
 {
 	mat4x4_identity(T);
@@ -0,0 +1,176 @@
+#include "linmath_bench.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "linmath.h"
+#include "timer.h"
+
+#define MATS 64 /* distinct inputs cycled through by the per-call kernels */
+#define CALLS 4000000 /* per-call kernel iterations */
+#define BATCHES 2000 /* batch kernel iterations */
+
+static vec4 pts4[LINMATH_BENCH_POINTS], out4[LINMATH_BENCH_POINTS], ref4[LINMATH_BENCH_POINTS];
+static vec2 pts2[LINMATH_BENCH_POINTS], out2[LINMATH_BENCH_POINTS], ref2[LINMATH_BENCH_POINTS];
+
+static float linmath_bench_rand(float range);
+static uint32_t linmath_bench_ulp(const float* a, const float* b, int n);
+static void linmath_bench_row(const char* name, float scalar_ns, float simd_ns, uint32_t ulp);
+
+int linmath_bench(void) {
+	/*
+	 * the per-call kernels cycle through MATS inputs so the work can't be hoisted out of the
+	 * loop, the batch kernels run over LINMATH_BENCH_POINTS points per call.
+	 * every SIMD result is compared against the scalar one before anything is timed
+	 */
+
+	static mat4x4 a[MATS], b[MATS], out[MATS], ref[MATS];
+	static vec4 v[MATS];
+	volatile float sink = 0.0f;
+	uint32_t ulp;
+	int fail = 0;
+
+	srand(1);
+
+	for (int i = 0; i < MATS; ++i) {
+		for (int c = 0; c < 4; ++c) {
+			for (int r = 0; r < 4; ++r) {
+				a[i][c][r] = linmath_bench_rand(2.0f);
+				b[i][c][r] = linmath_bench_rand(2.0f);
+			}
+			v[i][c] = linmath_bench_rand(1000.0f);
+		}
+	}
+
+	for (int i = 0; i < LINMATH_BENCH_POINTS; ++i) {
+		for (int k = 0; k < 4; ++k) pts4[i][k] = linmath_bench_rand(1000.0f);
+		pts2[i][0] = pts4[i][0];
+		pts2[i][1] = pts4[i][1];
+	}
+
+	printf("linmath: %s kernels against scalar (ns per call, or per point for the batches)\n", linmath_simd());
+	printf("%-22s %10s %10s %9s %8s\n", "kernel", "scalar", linmath_simd(), "speedup", "max ulp");
+
+	/* mat4x4_mul */
+	for (int i = 0; i < MATS; ++i) {
+		mat4x4_mul_scalar(ref[i], a[i], b[i]);
+		mat4x4_mul(out[i], a[i], b[i]);
+	}
+	ulp = linmath_bench_ulp(&out[0][0][0], &ref[0][0][0], MATS * 16);
+
+	tp start = timer_get();
+	for (int i = 0; i < CALLS; ++i) mat4x4_mul_scalar(out[i % MATS], a[i % MATS], b[(i + 1) % MATS]);
+	float scalar_ms = timer_diff(start);
+	sink += out[0][0][0];
+
+	start = timer_get();
+	for (int i = 0; i < CALLS; ++i) mat4x4_mul(out[i % MATS], a[i % MATS], b[(i + 1) % MATS]);
+	float simd_ms = timer_diff(start);
+	sink += out[0][0][0];
+
+	linmath_bench_row("mat4x4_mul", scalar_ms * 1e6f / CALLS, simd_ms * 1e6f / CALLS, ulp);
+	fail |= ulp > LINMATH_BENCH_ULP;
+
+	/* mat4x4_mul_vec4 */
+	for (int i = 0; i < MATS; ++i) {
+		mat4x4_mul_vec4_scalar(ref4[i], a[i], v[i]);
+		mat4x4_mul_vec4(out4[i], a[i], v[i]);
+	}
+	ulp = linmath_bench_ulp(out4[0], ref4[0], MATS * 4);
+
+	start = timer_get();
+	for (int i = 0; i < CALLS; ++i) mat4x4_mul_vec4_scalar(out4[i % MATS], a[i % MATS], v[(i + 1) % MATS]);
+	scalar_ms = timer_diff(start);
+	sink += out4[0][0];
+
+	start = timer_get();
+	for (int i = 0; i < CALLS; ++i) mat4x4_mul_vec4(out4[i % MATS], a[i % MATS], v[(i + 1) % MATS]);
+	simd_ms = timer_diff(start);
+	sink += out4[0][0];
+
+	linmath_bench_row("mat4x4_mul_vec4", scalar_ms * 1e6f / CALLS, simd_ms * 1e6f / CALLS, ulp);
+	fail |= ulp > LINMATH_BENCH_ULP;
+
+	/* mat4x4_mul_vec4_batch */
+	mat4x4_mul_vec4_batch_scalar(ref4, a[0], pts4, LINMATH_BENCH_POINTS);
+	mat4x4_mul_vec4_batch(out4, a[0], pts4, LINMATH_BENCH_POINTS);
+	ulp = linmath_bench_ulp(out4[0], ref4[0], LINMATH_BENCH_POINTS * 4);
+
+	start = timer_get();
+	for (int i = 0; i < BATCHES; ++i) mat4x4_mul_vec4_batch_scalar(out4, a[i % MATS], pts4, LINMATH_BENCH_POINTS);
+	scalar_ms = timer_diff(start);
+	sink += out4[0][0];
+
+	start = timer_get();
+	for (int i = 0; i < BATCHES; ++i) mat4x4_mul_vec4_batch(out4, a[i % MATS], pts4, LINMATH_BENCH_POINTS);
+	simd_ms = timer_diff(start);
+	sink += out4[0][0];
+
+	linmath_bench_row("mat4x4_mul_vec4_batch", scalar_ms * 1e6f / BATCHES / LINMATH_BENCH_POINTS, simd_ms * 1e6f / BATCHES / LINMATH_BENCH_POINTS, ulp);
+	fail |= ulp > LINMATH_BENCH_ULP;
+
+	/* mat4x4_mul_vec2_batch */
+	mat4x4_mul_vec2_batch_scalar(ref2, a[0], pts2, LINMATH_BENCH_POINTS);
+	mat4x4_mul_vec2_batch(out2, a[0], pts2, LINMATH_BENCH_POINTS);
+	ulp = linmath_bench_ulp(out2[0], ref2[0], LINMATH_BENCH_POINTS * 2);
+
+	start = timer_get();
+	for (int i = 0; i < BATCHES; ++i) mat4x4_mul_vec2_batch_scalar(out2, a[i % MATS], pts2, LINMATH_BENCH_POINTS);
+	scalar_ms = timer_diff(start);
+	sink += out2[0][0];
+
+	start = timer_get();
+	for (int i = 0; i < BATCHES; ++i) mat4x4_mul_vec2_batch(out2, a[i % MATS], pts2, LINMATH_BENCH_POINTS);
+	simd_ms = timer_diff(start);
+	sink += out2[0][0];
+
+	linmath_bench_row("mat4x4_mul_vec2_batch", scalar_ms * 1e6f / BATCHES / LINMATH_BENCH_POINTS, simd_ms * 1e6f / BATCHES / LINMATH_BENCH_POINTS, ulp);
+	fail |= ulp > LINMATH_BENCH_ULP;
+
+	/* odd counts exercise the tails after the vector loops */
+	for (int n = 0; n < 9; ++n) {
+		mat4x4_mul_vec4_batch_scalar(ref4, a[n], pts4, n);
+		mat4x4_mul_vec4_batch(out4, a[n], pts4, n);
+		mat4x4_mul_vec2_batch_scalar(ref2, a[n], pts2, n);
+		mat4x4_mul_vec2_batch(out2, a[n], pts2, n);
+
+		if (linmath_bench_ulp(out4[0], ref4[0], n * 4) > LINMATH_BENCH_ULP || linmath_bench_ulp(out2[0], ref2[0], n * 2) > LINMATH_BENCH_ULP) {
+			printf("linmath: batch of %d points out of tolerance\n", n);
+			fail = 1;
+		}
+	}
+
+	printf("linmath: %s, tolerance %d ulp\n", fail ? "FAIL" : "ok", LINMATH_BENCH_ULP);
+
+	(void) sink;
+	return fail;
+}
+
+float linmath_bench_rand(float range) {
+	return ((float) rand() / RAND_MAX * 2.0f - 1.0f) * range;
+}
+
+uint32_t linmath_bench_ulp(const float* a, const float* b, int n) {
+	/* floats mapped onto a monotonic integer line, so +0 and -0 are the same point */
+	uint32_t worst = 0;
+
+	for (int i = 0; i < n; ++i) {
+		int32_t ia, ib;
+		memcpy(&ia, a + i, sizeof ia);
+		memcpy(&ib, b + i, sizeof ib);
+
+		if (ia < 0) ia = INT32_MIN - ia;
+		if (ib < 0) ib = INT32_MIN - ib;
+
+		uint32_t d = ia > ib ? (uint32_t) ia - (uint32_t) ib : (uint32_t) ib - (uint32_t) ia;
+		if (d > worst) worst = d;
+	}
+
+	return worst;
+}
+
+void linmath_bench_row(const char* name, float scalar_ns, float simd_ns, uint32_t ulp) {
+	printf("%-22s %10.2f %10.2f %8.2fx %8u\n", name, scalar_ns, simd_ns, scalar_ns / simd_ns, ulp);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+/*
+ * linmath_bench
+ *
+ * throughput of the SIMD linmath kernels against their scalar versions, plus a check
+ * that every SIMD result is within LINMATH_BENCH_ULP of the scalar one.
+ */
+
+#define LINMATH_BENCH_ULP 1 /* allowed distance, the kernels are expected to match exactly */
+#define LINMATH_BENCH_POINTS 4096 /* points per batch call */
+
+int linmath_bench(void); /* nonzero if a result was out of tolerance */
@@ -0,0 +1,192 @@
+#include "overlay.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#include <GLXW/glxw.h>
+
+#include "tileproto.h"
+
+static unsigned quad_prg, quad_vao, loc_size, refs;
+
+/* quad from the vertex index, size pixels from the lower left. the layer holds premultiplied colour */
+static const char* overlay_vs = "#version 330\n"
+			CAMERA_BLOCK
+			"uniform vec2 size;\n"
+			"out vec2 t;\n"
+			"void main(void) {\n"
+			"	t = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+			"	gl_Position = screen * vec4(t * size, 0.0, 1.0);\n"
+			"}\n";
+
+static const char* overlay_fs = "#version 330\n"
+			"uniform sampler2D layer;\n"
+			"in vec2 t;\n"
+			"out vec4 color;\n"
+			"void main(void) {\n"
+			"	color = texture(layer, t);\n"
+			"}\n";
+
+static void overlay_hash(overlay* o, const void* data, size_t len);
+static void overlay_redraw(overlay* o);
+
+overlay* overlay_create(int w, int h, float rate) {
+	if (!refs) {
+		quad_prg = make_program(overlay_vs, overlay_fs);
+		if (!quad_prg) return NULL;
+
+		glUseProgram(quad_prg);
+		glUniform1i(glGetUniformLocation(quad_prg, "layer"), 0);
+		loc_size = glGetUniformLocation(quad_prg, "size");
+		glUseProgram(prg);
+
+		glGenVertexArrays(1, &quad_vao);
+	}
+
+	overlay* o = calloc(1, sizeof *o);
+	if (!o) return NULL;
+
+	refs++;
+	o->w = w;
+	o->h = h;
+	o->rate = rate;
+
+	glGenTextures(1, &o->tex);
+	glBindTexture(GL_TEXTURE_2D, o->tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenFramebuffers(1, &o->fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, o->fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, o->tex, 0);
+
+	int complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, screen_fbo);
+
+	if (!complete) {
+		printf("overlay: incomplete framebuffer\n");
+		overlay_free(o);
+		return NULL;
+	}
+
+	return o;
+}
+
+void overlay_free(overlay* o) {
+	if (!o) return;
+
+	glDeleteFramebuffers(1, &o->fbo);
+	glDeleteTextures(1, &o->tex);
+	free(o);
+
+	if (--refs) return;
+
+	glDeleteProgram(quad_prg);
+	glDeleteVertexArrays(1, &quad_vao);
+}
+
+void overlay_set_rate(overlay* o, float rate) {
+	o->rate = rate;
+}
+
+void overlay_begin(overlay* o) {
+	o->count = 0;
+	o->hash = 14695981039346656037ULL; /* fnv-1a offset basis */
+}
+
+void overlay_text(overlay* o, tk_font* font, const float* col, int x, int y, int flags, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+
+	char str[TK_TEXT_MAXLEN] = {0};
+	vsnprintf(str, sizeof str, fmt, args);
+	va_end(args);
+
+	tk_span span = { col, str };
+	overlay_spans(o, font, x, y, flags, &span, 1);
+}
+
+void overlay_spans(overlay* o, tk_font* font, int x, int y, int flags, const tk_span* spans, int count) {
+	if (o->count == OVERLAY_LINES) return;
+	if (count > OVERLAY_SPANS) count = OVERLAY_SPANS;
+
+	overlay_line* l = o->lines + o->count++;
+
+	l->font = font;
+	l->x = x;
+	l->y = y;
+	l->flags = flags;
+	l->count = count;
+
+	/* colours are copied, the font's can change before the next redraw */
+	for (int i = 0; i < count; ++i) {
+		memcpy(l->col[i], spans[i].col ? spans[i].col : font->col, sizeof l->col[i]);
+		strncpy(l->str[i], spans[i].str, TK_TEXT_MAXLEN - 1);
+		l->str[i][TK_TEXT_MAXLEN - 1] = 0;
+
+		overlay_hash(o, l->col[i], sizeof l->col[i]);
+		overlay_hash(o, l->str[i], strlen(l->str[i]));
+	}
+
+	overlay_hash(o, l, offsetof(overlay_line, col));
+}
+
+void overlay_end(overlay* o) {
+	/* content changed and the interval is up, or it's the very first draw */
+	if (o->hash != o->drawn_hash) {
+		if (!o->last_redraw || o->rate <= 0.0f || timer_diff(o->last_redraw) >= 1000.0f / o->rate) overlay_redraw(o);
+	}
+
+	glUseProgram(quad_prg);
+	glUniform2f(loc_size, o->w, o->h);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+	glBindVertexArray(quad_vao);
+	glBindTexture(GL_TEXTURE_2D, o->tex);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glUseProgram(prg);
+}
+
+void overlay_redraw(overlay* o) {
+	static const float clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	glBindFramebuffer(GL_FRAMEBUFFER, o->fbo);
+	glClearBufferfv(GL_COLOR, 0, clear);
+
+	tk_text_begin();
+
+	for (int i = 0; i < o->count; ++i) {
+		overlay_line* l = o->lines + i;
+		tk_span spans[OVERLAY_SPANS];
+
+		for (int s = 0; s < l->count; ++s) {
+			spans[s].col = l->col[s];
+			spans[s].str = l->str[s];
+		}
+
+		tk_font_render_spans(l->font, l->x, l->y, l->flags, spans, l->count);
+	}
+
+	tk_text_end();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, screen_fbo);
+
+	o->drawn_hash = o->hash;
+	o->last_redraw = timer_get();
+	o->redraws++;
+}
+
+void overlay_hash(overlay* o, const void* data, size_t len) {
+	const unsigned char* p = data;
+
+	for (size_t i = 0; i < len; ++i) {
+		o->hash ^= p[i];
+		o->hash *= 1099511628211ULL;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+ * overlay
+ *
+ * retained screen-space text layer. each frame a demo lists its HUD text between
+ * overlay_begin and overlay_end, but the text is only drawn (into the layer's own texture)
+ * when the listed content changed and the refresh interval has passed. every other frame
+ * the layer costs one textured quad.
+ */
+
+#include "text.h"
+#include "timer.h"
+
+#define OVERLAY_LINES 32 /* draws per layer */
+#define OVERLAY_SPANS 4 /* spans per draw */
+#define OVERLAY_RATE 4.0f /* default redraws per second, 0 redraws on every change */
+
+typedef struct _overlay_line {
+	tk_font* font;
+	int x, y, flags, count;
+	float col[OVERLAY_SPANS][4];
+	char str[OVERLAY_SPANS][TK_TEXT_MAXLEN];
+} overlay_line;
+
+typedef struct _overlay {
+	unsigned tex, fbo;
+	int w, h;
+	float rate;
+	tp last_redraw;
+	unsigned long long hash, drawn_hash; /* content listed this frame and content in the texture */
+	unsigned redraws;
+	int count;
+	overlay_line lines[OVERLAY_LINES];
+} overlay;
+
+overlay* overlay_create(int w, int h, float rate); /* w, h should match the screen */
+void overlay_free(overlay* o);
+void overlay_set_rate(overlay* o, float rate);
+
+void overlay_begin(overlay* o);
+void overlay_text(overlay* o, tk_font* font, const float* col, int x, int y, int flags, const char* fmt, ...); /* NULL col uses the font's */
+void overlay_spans(overlay* o, tk_font* font, int x, int y, int flags, const tk_span* spans, int count);
+void overlay_end(overlay* o); /* redraws the texture if it's due, then draws the layer */
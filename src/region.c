@@ -0,0 +1,179 @@
+#include "region.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "defs.h"
+
+#define REGION_MAPS 256 /* max region files mapped at once */
+#define REGION_CHUNKBYTES (CHUNKSIZE * CHUNKSIZE * sizeof(tile_t))
+
+typedef struct _region_map {
+	int rx, ry;
+	const uint8_t* base; /* NULL if the file is missing or bad, so it isn't retried */
+	size_t size;
+} region_map;
+
+static char* region_dir;
+static region_map maps[REGION_MAPS];
+static int nmaps;
+static pthread_mutex_t maps_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const region_map* region_get(int rx, int ry);
+static const uint8_t* region_map_file(int rx, int ry, size_t* size);
+static int region_div(int v);
+
+int region_open(const char* dir) {
+	region_close();
+
+	struct stat st;
+	if (stat(dir, &st) || !S_ISDIR(st.st_mode)) {
+		printf("region: %s is not a directory\n", dir);
+		return 1;
+	}
+
+	region_dir = strdup(dir);
+	printf("region: reading chunks from %s\n", dir);
+	return region_dir == NULL;
+}
+
+void region_close(void) {
+	for (int i = 0; i < nmaps; ++i) {
+		if (maps[i].base) munmap((void*) maps[i].base, maps[i].size);
+	}
+
+	nmaps = 0;
+	free(region_dir);
+	region_dir = NULL;
+}
+
+const tile_t* region_chunk(int cx, int cy) {
+	if (!region_dir) return NULL;
+
+	int rx = region_div(cx), ry = region_div(cy);
+	const region_map* m = region_get(rx, ry);
+	if (!m || !m->base) return NULL;
+
+	const region_header* h = (const region_header*) m->base;
+	uint32_t off = h->offsets[(cx - rx * REGION_CHUNKS) + (cy - ry * REGION_CHUNKS) * REGION_CHUNKS];
+
+	return off ? (const tile_t*) (m->base + off) : NULL;
+}
+
+int region_write(const char* dir, int rx, int ry, const tile_t* tiles) {
+	region_header h;
+	memset(&h, 0, sizeof h);
+
+	memcpy(h.magic, REGION_MAGIC, 4);
+	h.version = REGION_VERSION;
+	h.chunksize = CHUNKSIZE;
+	h.chunks = REGION_CHUNKS;
+
+	for (int i = 0; i < REGION_CHUNKS * REGION_CHUNKS; ++i) {
+		h.offsets[i] = sizeof h + i * REGION_CHUNKBYTES;
+	}
+
+	char path[4096], tmp[4096];
+
+	if (snprintf(path, sizeof path, "%s/r.%d.%d.bin", dir, rx, ry) >= (int) sizeof path || snprintf(tmp, sizeof tmp, "%s.tmp", path) >= (int) sizeof tmp) {
+		printf("region: path too long in %s\n", dir);
+		return 1;
+	}
+
+	FILE* f = fopen(tmp, "wb");
+	if (!f) {
+		printf("region: can't write %s: %s\n", tmp, strerror(errno));
+		return 1;
+	}
+
+	int bad = fwrite(&h, sizeof h, 1, f) != 1;
+	bad |= fwrite(tiles, REGION_CHUNKBYTES, REGION_CHUNKS * REGION_CHUNKS, f) != REGION_CHUNKS * REGION_CHUNKS;
+	bad |= fclose(f) != 0;
+
+	/* readers that already mapped the old file keep their copy, new readers see the whole new one */
+	if (bad || rename(tmp, path)) {
+		printf("region: failed writing %s\n", path);
+		unlink(tmp);
+		return 1;
+	}
+
+	return 0;
+}
+
+const region_map* region_get(int rx, int ry) {
+	region_map* m = NULL;
+
+	pthread_mutex_lock(&maps_lock);
+
+	for (int i = 0; i < nmaps; ++i) {
+		if (maps[i].rx == rx && maps[i].ry == ry) {
+			m = maps + i;
+			break;
+		}
+	}
+
+	if (!m && nmaps < REGION_MAPS) {
+		/* mapped under the lock, two workers asking for the same new region must not both map it */
+		m = maps + nmaps;
+		m->rx = rx;
+		m->ry = ry;
+		m->base = region_map_file(rx, ry, &m->size);
+		nmaps++;
+	} else if (!m) {
+		printf("region: too many regions mapped, ignoring (%d, %d)\n", rx, ry);
+	}
+
+	pthread_mutex_unlock(&maps_lock);
+	return m;
+}
+
+const uint8_t* region_map_file(int rx, int ry, size_t* size) {
+	char path[4096];
+	snprintf(path, sizeof path, "%s/r.%d.%d.bin", region_dir, rx, ry);
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return NULL; /* not stored, not an error */
+
+	struct stat st;
+	if (fstat(fd, &st) || (size_t) st.st_size < sizeof(region_header)) {
+		printf("region: %s is truncated\n", path);
+		close(fd);
+		return NULL;
+	}
+
+	*size = st.st_size;
+	const uint8_t* base = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (base == MAP_FAILED) {
+		printf("region: can't map %s: %s\n", path, strerror(errno));
+		return NULL;
+	}
+
+	const region_header* h = (const region_header*) base;
+	int bad = memcmp(h->magic, REGION_MAGIC, 4) || h->version != REGION_VERSION || h->chunksize != CHUNKSIZE || h->chunks != REGION_CHUNKS;
+
+	for (int i = 0; i < REGION_CHUNKS * REGION_CHUNKS && !bad; ++i) {
+		bad = h->offsets[i] && (h->offsets[i] < sizeof *h || (size_t) h->offsets[i] + REGION_CHUNKBYTES > *size || h->offsets[i] % sizeof(tile_t));
+	}
+
+	if (bad) {
+		printf("region: %s is not a valid %dx%d region of %d-tile chunks\n", path, REGION_CHUNKS, REGION_CHUNKS, CHUNKSIZE);
+		munmap((void*) base, *size);
+		return NULL;
+	}
+
+	return base;
+}
+
+int region_div(int v) {
+	/* floor division, so chunk -1 lands in region -1 */
+	return v >= 0 ? v / REGION_CHUNKS : -((-v + REGION_CHUNKS - 1) / REGION_CHUNKS);
+}
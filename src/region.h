@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+
+#include "defs.h"
+
+/*
+ * region
+ *
+ * on-disk chunk store. chunks are grouped REGION_CHUNKS x REGION_CHUNKS to a file
+ * named r.<rx>.<ry>.bin, which starts with a header holding the offset of every chunk.
+ * files are mmap'd read-only the first time they're touched and stay mapped until
+ * region_close, so a chunk fetch is a table lookup and a pointer into the mapping.
+ * region_chunk is safe to call from worker threads.
+ */
+
+#define REGION_CHUNKS 16 /* chunks per side of a region */
+#define REGION_MAGIC "TPRG"
+#define REGION_VERSION 2 /* 2: 16-bit tile ids */
+
+typedef struct _region_header {
+	char magic[4];
+	uint32_t version, chunksize, chunks; /* tiles per chunk side, chunks per region side */
+	uint32_t offsets[REGION_CHUNKS * REGION_CHUNKS]; /* byte offset of each chunk's tiles, 0 if not stored */
+} region_header;
+
+int region_open(const char* dir);
+void region_close(void);
+
+const tile_t* region_chunk(int cx, int cy); /* CHUNKSIZE*CHUNKSIZE tiles or NULL if not stored, valid until region_close */
+
+/*
+ * writes one region file. tiles holds REGION_CHUNKS*REGION_CHUNKS chunks of CHUNKSIZE*CHUNKSIZE tiles,
+ * row by row starting at chunk (rx*REGION_CHUNKS, ry*REGION_CHUNKS). replaces any existing file atomically
+ */
+int region_write(const char* dir, int rx, int ry, const tile_t* tiles);
@@ -1,18 +1,21 @@
 #pragma once
 
-const char* vs_render = "#version 130\n"
-			"attribute vec2 position;\n"
-			"attribute vec2 in_texcoord;\n"
-			"varying vec2 texcoord;\n"
-			"uniform mat4x4 transform;\n"
+#include "tileproto.h"
+
+const char* vs_render = "#version 330\n"
+			CAMERA_BLOCK
+			"layout(location = 0) in vec2 position;\n"
+			"layout(location = 1) in vec2 in_texcoord;\n"
+			"out vec2 texcoord;\n"
 			"void main(void) {\n"
-			"	gl_Position = transform * vec4(position, 0.0f, 1.0f);\n"
+			"	gl_Position = viewproj * vec4(position, 0.0, 1.0);\n"
 			"	texcoord = in_texcoord;\n"
 			"}\n";
 
-const char* fs_render = "#version 130\n"
+const char* fs_render = "#version 330\n"
 			"uniform sampler2D tex;\n"
-			"varying vec2 texcoord;\n"
+			"in vec2 texcoord;\n"
+			"out vec4 color;\n"
 			"void main(void) {\n"
-			"	gl_FragColor = texture(tex, texcoord);\n"
+			"	color = texture(tex, texcoord);\n"
 			"}\n";
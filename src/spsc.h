@@ -0,0 +1,54 @@
+#pragma once
+#include <stdlib.h>
+
+/*
+ * spsc
+ *
+ * lock-free single-producer/single-consumer ring of pointers.
+ * exactly one thread may push and exactly one thread may pop.
+ * head and tail live on separate cache lines so the two sides don't false-share.
+ */
+
+typedef struct _spsc {
+	void** buf;
+	unsigned cap; /* power of two */
+	unsigned head __attribute__((aligned(64))); /* written by the consumer */
+	unsigned tail __attribute__((aligned(64))); /* written by the producer */
+} spsc;
+
+static inline int spsc_init(spsc* r, unsigned cap) {
+	unsigned c = 2;
+	while (c < cap) c <<= 1;
+
+	r->buf = malloc(sizeof *r->buf * c);
+	r->cap = c;
+	r->head = r->tail = 0;
+	return r->buf == NULL;
+}
+
+static inline void spsc_free(spsc* r) {
+	free(r->buf);
+	r->buf = NULL;
+}
+
+static inline int spsc_push(spsc* r, void* v) {
+	unsigned tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+	unsigned head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+	if (tail - head == r->cap) return 1;
+
+	r->buf[tail & (r->cap - 1)] = v;
+	__atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static inline void* spsc_pop(spsc* r) {
+	unsigned head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+	unsigned tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+	if (head == tail) return NULL;
+
+	void* v = r->buf[head & (r->cap - 1)];
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+	return v;
+}
@@ -0,0 +1,132 @@
+#include "texpool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <GLXW/glxw.h>
+
+typedef struct _texpool_page {
+	unsigned tex, fbos[TEXPOOL_PAGE];
+} texpool_page;
+
+static texpool_page pages[TEXPOOL_MAX_PAGES];
+static texpool_target* pool; /* free targets */
+static int pool_free, pool_w, pool_h;
+static texpool_stats stats;
+
+static int texpool_add_page(void);
+
+int texpool_init(int capacity, int w, int h) {
+	int count = (capacity + TEXPOOL_PAGE - 1) / TEXPOOL_PAGE;
+
+	if (count > TEXPOOL_MAX_PAGES) {
+		printf("texpool: %d targets need more than %d pages\n", capacity, TEXPOOL_MAX_PAGES);
+		return 1;
+	}
+
+	pool = malloc(sizeof *pool * TEXPOOL_PAGE * TEXPOOL_MAX_PAGES);
+	if (!pool) return 1;
+
+	pool_w = w;
+	pool_h = h;
+	pool_free = 0;
+
+	stats.capacity = stats.in_use = stats.pages = 0;
+	stats.hits = stats.misses = 0;
+
+	for (int i = 0; i < count; ++i) {
+		if (texpool_add_page()) return 1;
+	}
+
+	printf("texpool: %d render targets in %d pages, %d KB\n", stats.capacity, stats.pages, stats.capacity * w * h * 4 / 1024);
+	return 0;
+}
+
+void texpool_free(void) {
+	for (int i = 0; i < stats.pages; ++i) {
+		glDeleteFramebuffers(TEXPOOL_PAGE, pages[i].fbos);
+		glDeleteTextures(1, &pages[i].tex);
+	}
+
+	free(pool);
+	pool = NULL;
+	pool_free = 0;
+	stats.pages = stats.capacity = 0;
+}
+
+int texpool_borrow(texpool_target* t) {
+	if (pool_free) {
+		stats.hits++;
+	} else {
+		if (stats.pages == TEXPOOL_MAX_PAGES || texpool_add_page()) return 1;
+		stats.misses++;
+	}
+
+	*t = pool[--pool_free];
+	stats.in_use++;
+	return 0;
+}
+
+void texpool_return(const texpool_target* t) {
+	stats.in_use--;
+	pool[pool_free++] = *t;
+}
+
+unsigned texpool_page_tex(int page) {
+	return pages[page].tex;
+}
+
+const texpool_stats* texpool_get_stats(void) {
+	return &stats;
+}
+
+int texpool_add_page(void) {
+	texpool_page* p = pages + stats.pages;
+
+	glGenTextures(1, &p->tex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, p->tex);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, pool_w, pool_h, TEXPOOL_PAGE, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	int prev;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev); /* may be called mid-frame */
+
+	/* one FBO per layer, so a compile only ever touches its own layer */
+	glGenFramebuffers(TEXPOOL_PAGE, p->fbos);
+
+	GLenum db[1] = {GL_COLOR_ATTACHMENT0};
+	int status = GL_FRAMEBUFFER_COMPLETE;
+
+	for (int i = 0; i < TEXPOOL_PAGE && status == GL_FRAMEBUFFER_COMPLETE; ++i) {
+		glBindFramebuffer(GL_FRAMEBUFFER, p->fbos[i]);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, p->tex, 0, i);
+		glDrawBuffers(1, db);
+		status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, prev);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		printf("texpool: FBO init failed\n");
+		glDeleteFramebuffers(TEXPOOL_PAGE, p->fbos);
+		glDeleteTextures(1, &p->tex);
+		return 1;
+	}
+
+	/* pushed in reverse so layers are handed out in order */
+	for (int i = TEXPOOL_PAGE - 1; i >= 0; --i) {
+		texpool_target* t = pool + pool_free++;
+		t->tex = p->tex;
+		t->fbo = p->fbos[i];
+		t->page = stats.pages;
+		t->layer = i;
+	}
+
+	stats.pages++;
+	stats.capacity += TEXPOOL_PAGE;
+	return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+ * texpool
+ *
+ * pool of pre-allocated chunk render targets. targets are layers of a few large array
+ * textures (pages), each layer with its own FBO, so every ready chunk on one page can be
+ * drawn with a single instanced call. chunks borrow a target when they compile and return
+ * it when freed, so scrolling around doesn't churn texture and framebuffer allocations.
+ * when the pool runs dry another page is allocated (a miss) and kept until texpool_free.
+ */
+
+#define TEXPOOL_PAGE 16 /* layers per array texture */
+#define TEXPOOL_MAX_PAGES 8
+
+typedef struct _texpool_target {
+	unsigned tex, fbo; /* tex is the page's array texture */
+	int page, layer;
+} texpool_target;
+
+typedef struct _texpool_stats {
+	int capacity, in_use, pages;
+	unsigned hits, misses;
+} texpool_stats;
+
+int texpool_init(int capacity, int w, int h); /* capacity is rounded up to whole pages */
+void texpool_free(void);
+
+int texpool_borrow(texpool_target* t); /* nonzero if no target could be provided */
+void texpool_return(const texpool_target* t);
+
+unsigned texpool_page_tex(int page);
+const texpool_stats* texpool_get_stats(void);
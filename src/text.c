@@ -1,165 +1,470 @@
 #include "text.h"
 
+#include <stddef.h>
+#include <math.h>
+
 #include <GLXW/glxw.h>
 
+#include "timer.h"
+#include "camera.h"
+
+typedef struct _tk_vert {
+	float x, y, u, v;
+	unsigned char col[4], ocol[4];
+	float outline; /* sdf distance units inside the edge that take ocol */
+} tk_vert;
+
 static unsigned init = 0;
 static FT_Library ctx;
-static unsigned vs, fs, prg, loc_tex, loc_col;
+static unsigned vs, fs, fs_sdf, prg, prg_sdf, vao, vbo;
+
+/* pending glyph quads, flushed when the atlas changes, the batch fills up or at tk_text_end */
+static tk_vert batch[TK_TEXT_BATCH * 6];
+static unsigned batch_len, batch_tex, batch_sdf, batching;
+
+static tk_face* faces; /* every loaded face, see tk_font_init */
 
 void tk_text_init(void);
-float pixel_map(int p, int view);
+static void tk_text_flush(void);
+static tk_font* tk_font_open(const char* filename, int size, int sdf);
+static tk_face* tk_face_load(const char* filename, int size, int sdf);
+static void tk_face_sdf(const unsigned char* src, int pitch, int gw, int gh, unsigned char* dest);
+static float tk_text_quads(const tk_face* f, float x, float y, float scale, const char* str, const unsigned char* col, const unsigned char* ocol, float outline);
+static unsigned int tk_text_program(unsigned int frag);
 static unsigned int make_shader(const char* str, GLenum type);
 
-const char* tk_text_vs = "#version 130\nattribute vec2 p;\nattribute vec2 ti;\nvarying vec2 t;\n"
-			 "void main() { gl_Position = vec4(p, 0, 1); t = ti; }\n";
-const char* tk_text_fs = "#version 130\nuniform sampler2D tx;\nuniform vec4 c;\nvarying vec2 t;\n"
-			 "void main() { gl_FragColor = vec4(1.0, 1.0, 1.0, texture2D(tx, t).r)*c; }\n";
+/* positions stay in pixels, the camera block's screen matrix takes them to clip space */
+const char* tk_text_vs = "#version 330\n"
+			 CAMERA_BLOCK
+			 "layout(location = 0) in vec2 p;\n"
+			 "layout(location = 1) in vec2 ti;\n"
+			 "layout(location = 2) in vec4 ci;\n"
+			 "layout(location = 3) in vec4 oci;\n"
+			 "layout(location = 4) in float owi;\n"
+			 "out vec2 t;\n"
+			 "out vec4 c, oc;\n"
+			 "out float ow;\n"
+			 "void main() { gl_Position = screen * vec4(p, 0, 1); t = ti; c = ci; oc = oci; ow = owi; }\n";
+const char* tk_text_fs = "#version 330\nuniform sampler2D tx;\nin vec2 t;\nin vec4 c;\nout vec4 color;\n"
+			 "void main() { color = vec4(1.0, 1.0, 1.0, texture(tx, t).r)*c; }\n";
+
+/* 0.5 is the glyph edge and the outline grows outward by ow, fwidth keeps the edge about a pixel soft at any scale */
+const char* tk_text_fs_sdf = "#version 330\n"
+			 "uniform sampler2D tx;\n"
+			 "in vec2 t;\n"
+			 "in vec4 c, oc;\n"
+			 "in float ow;\n"
+			 "out vec4 color;\n"
+			 "void main() {\n"
+			 "	float d = texture(tx, t).r, aa = max(fwidth(d) * 0.5, 1e-4);\n"
+			 "	float fill = smoothstep(0.5 - aa, 0.5 + aa, d);\n"
+			 "	float shape = smoothstep(0.5 - ow - aa, 0.5 - ow + aa, d);\n"
+			 "	color = mix(oc, c, fill);\n"
+			 "	color.a *= shape;\n"
+			 "}\n";
 
 tk_font* tk_font_init(const char* filename, int size) {
-	if (!init) tk_text_init();
-	if (!init) return NULL;
+	return tk_font_open(filename, size, 0);
+}
 
-	tk_font* output = malloc(sizeof* output);
-	memset(output, 0, sizeof *output);
+tk_font* tk_font_init_sdf(const char* filename, int size) {
+	tk_font* output = tk_font_open(filename, TK_TEXT_SDF_SIZE, 1);
+	if (output) output->size_px = size;
 
-	output->col[0] = output->col[1] = output->col[2] = output->col[3] = 1.0f;
-
-	if (!output) return NULL;
+	return output;
+}
 
-	int er = FT_New_Face(ctx, filename, 0, &output->face);
+tk_font* tk_font_open(const char* filename, int size, int sdf) {
+	if (!init) tk_text_init();
+	if (!init) return NULL;
 
-	if (er == FT_Err_Unknown_File_Format) {
-		tk_die("Invalid font format: %s\n", filename);
-	} else if (er) {
-		tk_die("Failed loading: %s\n", filename);
-	}
+	tk_font* output = calloc(1, sizeof* output);
+	if (!output) return NULL;
 
+	output->col[0] = output->col[1] = output->col[2] = output->col[3] = 1.0f;
 	output->size_px = size;
-	FT_Set_Pixel_Sizes(output->face, 0, size);
-	glGenTextures(TK_TEXT_GLYPHS, output->glyphs);
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-	for (int i = 0; i < TK_TEXT_GLYPHS; ++i) {
-		glBindTexture(GL_TEXTURE_2D, output->glyphs[i]);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-		if (FT_Load_Char(output->face, i, FT_LOAD_RENDER)) {
-			continue;
+	/* faces are cached by file, size and kind, another handle only bumps the refcount */
+	for (tk_face* f = faces; f; f = f->next) {
+		if (f->size_px == size && f->sdf == sdf && !strcmp(f->filename, filename)) {
+			f->refs++;
+			output->face = f;
+			return output;
 		}
+	}
 
-		FT_GlyphSlot g = output->face->glyph;
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, g->bitmap.width, g->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE, g->bitmap.buffer);
+	output->face = tk_face_load(filename, size, sdf);
+	if (!output->face) {
+		free(output);
+		return NULL;
 	}
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-	tk_log("loaded glyphs for %s\n", filename);
+	output->face->next = faces;
+	faces = output->face;
 
 	return output;
 }
 
 void tk_font_free(tk_font* dest) {
+	if (!dest) return;
+
+	tk_face* f = dest->face;
 	free(dest);
+
+	if (--f->refs) return;
+
+	tk_face** link = &faces;
+	while (*link != f) link = &(*link)->next;
+	*link = f->next;
+
+	if (batch_tex == f->atlas) tk_text_flush();
+
+	glDeleteTextures(1, &f->atlas);
+	FT_Done_Face(f->face);
+	free(f->filename);
+	free(f);
 }
 
 void tk_font_render(tk_font* p, int x, int y, int flags, const char* fmt, ...) {
-	if (!init) return;
+	va_list args;
+	va_start(args, fmt);
+
+	char str[TK_TEXT_MAXLEN] = {0};
+	vsnprintf(str, sizeof str, fmt, args);
+	va_end(args);
 
+	tk_span span = { p->col, str };
+	tk_font_render_spans(p, x, y, flags, &span, 1);
+}
+
+void tk_font_render_col(tk_font* p, const float* col, int x, int y, int flags, const char* fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
 
 	char str[TK_TEXT_MAXLEN] = {0};
-	int len;
 	vsnprintf(str, sizeof str, fmt, args);
 	va_end(args);
 
-	len = strlen(str);
+	tk_span span = { col, str };
+	tk_font_render_spans(p, x, y, flags, &span, 1);
+}
 
-	glUseProgram(prg);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glBlendEquation(GL_FUNC_ADD);
-	glUniform4fv(loc_col, 1, p->col);
+void tk_font_render_spans(tk_font* p, int x, int y, int flags, const tk_span* spans, int count) {
+	if (!init) return;
 
-	/* keep viewport data */
-	int viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
+	TIMER_ZONE_BEGIN("tk_font_render");
 
-	float cx, cy; /* current drawing origin */
-	cx = pixel_map(x, viewport[2]);
-	cy = pixel_map(y, viewport[3]);
+	const tk_face* f = p->face;
+	float scale = (float) p->size_px / f->size_px;
 
-	/* compute total width in worldspace */
+	/* compute total width from the cached advances */
 	float total_width = 0.0f;
-	float sx = 2.0f / (float) viewport[2], sy = 2.0f / (float) viewport[3];
 
-	/* (sx, sy) is the screenspace size of 1 pixel */
-	for (int i = 0; i < len; ++i) {
-		if (FT_Load_Char(p->face, str[i], FT_LOAD_DEFAULT)) {
-			tk_log("Glpyh load failed for [%02x %c]\n", str[i], str[i]);
-			continue;
+	for (int s = 0; s < count; ++s) {
+		for (const char* c = spans[s].str; *c; ++c) {
+			total_width += f->glyphs[(unsigned char) *c].advance * scale;
 		}
-
-		FT_GlyphSlot g = p->face->glyph;
-		total_width += (g->advance.x >> 6) * sx;
 	}
 
-	float xoff = 0.0f;
+	float cx = x; /* current pen position in pixels */
 
 	if (flags & TK_TEXT_CENTER) {
-		xoff -= total_width / 2.0f;
+		cx -= total_width / 2.0f;
 	} else if (flags & TK_TEXT_RIGHT) {
-		xoff -= total_width;
+		cx -= total_width;
+	}
+
+	/* colour and effects are per vertex, so only a different face breaks the batch */
+	if (batch_tex != f->atlas) tk_text_flush();
+	batch_tex = f->atlas;
+	batch_sdf = f->sdf;
+
+	unsigned char col[4], ocol[4], scol[4];
+	float outline = 0.0f;
+
+	for (int i = 0; i < 4; ++i) {
+		ocol[i] = p->outline_col[i] * 255.0f + 0.5f;
+		scol[i] = p->shadow_col[i] * 255.0f + 0.5f;
+	}
+
+	/* outline width is in screen pixels, the atlas spreads 2 * TK_TEXT_SDF_SPREAD base pixels over 0..1 */
+	if (f->sdf && p->outline > 0.0f) {
+		outline = p->outline / scale / (2.0f * TK_TEXT_SDF_SPREAD);
+		if (outline > 0.45f) outline = 0.45f;
+	}
+
+	/* every shadow goes down before any glyph, so a shadow never covers the glyph before it */
+	if (scol[3]) {
+		float sx = cx + p->shadow_x;
+
+		for (int s = 0; s < count; ++s) {
+			sx = tk_text_quads(f, sx, y + p->shadow_y, scale, spans[s].str, scol, scol, outline);
+		}
+	}
+
+	for (int s = 0; s < count; ++s) {
+		const float* sc = spans[s].col ? spans[s].col : p->col;
+		for (int i = 0; i < 4; ++i) col[i] = sc[i] * 255.0f + 0.5f;
+
+		cx = tk_text_quads(f, cx, y, scale, spans[s].str, col, ocol, outline);
+	}
+
+	if (!batching) tk_text_flush();
+
+	TIMER_ZONE_END();
+}
+
+void tk_font_set_col(tk_font* p, float r, float g, float b, float a) {
+	p->col[0] = r;
+	p->col[1] = g;
+	p->col[2] = b;
+	p->col[3] = a;
+}
+
+void tk_font_set_size(tk_font* p, int size) {
+	p->size_px = size;
+}
+
+void tk_font_set_outline(tk_font* p, float width, float r, float g, float b, float a) {
+	p->outline = width;
+	p->outline_col[0] = r;
+	p->outline_col[1] = g;
+	p->outline_col[2] = b;
+	p->outline_col[3] = a;
+}
+
+void tk_font_set_shadow(tk_font* p, int dx, int dy, float r, float g, float b, float a) {
+	p->shadow_x = dx;
+	p->shadow_y = dy;
+	p->shadow_col[0] = r;
+	p->shadow_col[1] = g;
+	p->shadow_col[2] = b;
+	p->shadow_col[3] = a;
+}
+
+float tk_text_quads(const tk_face* f, float x, float y, float scale, const char* str, const unsigned char* col, const unsigned char* ocol, float outline) {
+	for (const char* c = str; *c; ++c) {
+		const tk_glyph* g = f->glyphs + (unsigned char) *c;
+
+		if (g->w && g->h) {
+			if (batch_len + 6 > sizeof batch / sizeof *batch) tk_text_flush();
+
+			float xl = x + g->left * scale, yt = y + g->top * scale;
+			float xr = xl + g->w * scale, yb = yt - g->h * scale;
+
+			tk_vert quad[6] = {
+				{ xl, yt, g->u0, g->v0 },
+				{ xr, yt, g->u1, g->v0 },
+				{ xl, yb, g->u0, g->v1 },
+				{ xr, yt, g->u1, g->v0 },
+				{ xr, yb, g->u1, g->v1 },
+				{ xl, yb, g->u0, g->v1 },
+			};
+
+			for (int v = 0; v < 6; ++v) {
+				memcpy(quad[v].col, col, 4);
+				memcpy(quad[v].ocol, ocol, 4);
+				quad[v].outline = outline;
+				batch[batch_len++] = quad[v];
+			}
+		}
+
+		x += g->advance * scale;
 	}
 
-	for (int i = 0; i < len; ++i) {
-		if (FT_Load_Char(p->face, str[i], FT_LOAD_RENDER)) {
-			tk_log("Glpyh load failed for [%02x %c]\n", str[i], str[i]);
+	return x;
+}
+
+tk_face* tk_face_load(const char* filename, int size, int sdf) {
+	tk_face* output = calloc(1, sizeof *output);
+	if (!output) return NULL;
+
+	int er = FT_New_Face(ctx, filename, 0, &output->face);
+
+	if (er == FT_Err_Unknown_File_Format) {
+		tk_die("Invalid font format: %s\n", filename);
+	} else if (er) {
+		tk_die("Failed loading: %s\n", filename);
+	}
+
+	output->filename = strdup(filename);
+	output->size_px = size;
+	output->sdf = sdf;
+	output->refs = 1;
+	FT_Set_Pixel_Sizes(output->face, 0, size);
+
+	/* every glyph is rasterized once, packed into shelves and its metrics kept for layout */
+	int w = TK_TEXT_ATLAS_W, h = 64, pen_x = 1, pen_y = 1, row_h = 0;
+	int pad = sdf ? TK_TEXT_SDF_SPREAD : 0;
+	unsigned char* pixels = calloc(w, h);
+	unsigned char* field = NULL;
+
+	if (!pixels) tk_die("Out of memory for the %s atlas\n", filename);
+
+	for (int i = 0; i < TK_TEXT_GLYPHS; ++i) {
+		if (FT_Load_Char(output->face, i, FT_LOAD_RENDER)) {
 			continue;
 		}
 
-		FT_GlyphSlot g = p->face->glyph;
+		FT_GlyphSlot g = output->face->glyph;
+		tk_glyph* gl = output->glyphs + i;
+
+		gl->advance = g->advance.x >> 6;
+		if (!g->bitmap.width || !g->bitmap.rows) continue;
+
+		/* sdf glyphs carry the spread as a border so outlines have room to grow */
+		int gw = g->bitmap.width + pad * 2, gh = g->bitmap.rows + pad * 2;
+		const unsigned char* src = g->bitmap.buffer;
+		int pitch = g->bitmap.pitch;
+
+		if (sdf) {
+			unsigned char* next = realloc(field, gw * gh);
+			if (!next) tk_die("Out of memory for the %s atlas\n", filename);
+
+			field = next;
+			tk_face_sdf(g->bitmap.buffer, g->bitmap.pitch, g->bitmap.width, g->bitmap.rows, field);
+			src = field;
+			pitch = gw;
+		}
+
+		gl->w = gw;
+		gl->h = gh;
+		gl->left = g->bitmap_left - pad;
+		gl->top = g->bitmap_top + pad;
+
+		if (pen_x + gw + 1 > w) {
+			pen_x = 1;
+			pen_y += row_h + 1;
+			row_h = 0;
+		}
+
+		while (pen_y + gh + 1 > h) {
+			unsigned char* next = realloc(pixels, w * h * 2);
+			if (!next) tk_die("Out of memory for the %s atlas\n", filename);
+
+			memset(next + w * h, 0, w * h);
+			pixels = next;
+			h *= 2;
+		}
+
+		for (int r = 0; r < gh; ++r) {
+			memcpy(pixels + (pen_y + r) * w + pen_x, src + r * pitch, gw);
+		}
+
+		/* uvs are fixed up once the final height is known */
+		gl->u0 = pen_x;
+		gl->v0 = pen_y;
+		gl->u1 = pen_x + gw;
+		gl->v1 = pen_y + gh;
+
+		pen_x += gw + 1;
+		if (gh > row_h) row_h = gh;
+	}
+
+	free(field);
+
+	for (int i = 0; i < TK_TEXT_GLYPHS; ++i) {
+		output->glyphs[i].u0 /= w;
+		output->glyphs[i].u1 /= w;
+		output->glyphs[i].v0 /= h;
+		output->glyphs[i].v1 /= h;
+	}
+
+	output->atlas_w = w;
+	output->atlas_h = h;
 
-		float gw = g->bitmap.width * sx, gh = g->bitmap.rows * sy;
-		float xl = cx + g->bitmap_left * sx, yt = cy + g->bitmap_top * sy;
+	/* distance fields are meant to be filtered, coverage glyphs are drawn 1:1 */
+	GLenum filter = sdf ? GL_LINEAR : GL_NEAREST;
 
-		float verts[16] = {
-			xl + xoff, yt, 0.0f, 0.0f,
-			xl + xoff + gw, yt, 1.0f, 0.0f,
-			xl + xoff, yt - gh, 0.0f, 1.0f,
-			xl + xoff + gw, yt - gh , 1.0f, 1.0f,
-		};
+	glGenTextures(1, &output->atlas);
+	glBindTexture(GL_TEXTURE_2D, output->atlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-		unsigned buf, vao;
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, w, h, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-		glGenBuffers(1, &buf);
-		glBindBuffer(GL_ARRAY_BUFFER, buf);
-		glBufferData(GL_ARRAY_BUFFER, sizeof verts, verts, GL_STATIC_DRAW);
+	free(pixels);
+	tk_log("loaded %sglyphs for %s into a %dx%d atlas\n", sdf ? "sdf " : "", filename, w, h);
 
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float)*4, NULL);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float)*4, (void*) (sizeof(float)*2));
+	return output;
+}
 
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
+void tk_face_sdf(const unsigned char* src, int pitch, int gw, int gh, unsigned char* dest) {
+	/*
+	 * brute force over a (2 * spread + 1)^2 window, anything further clamps anyway.
+	 * dest is the glyph plus a spread wide border, 128 on the edge and higher inside
+	 */
 
-		glBindTexture(GL_TEXTURE_2D, p->glyphs[(int) str[i]]);
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	const int s = TK_TEXT_SDF_SPREAD, w = gw + s * 2, h = gh + s * 2;
 
-		glDeleteBuffers(1, &buf);
-		glDeleteVertexArrays(1, &buf);
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			int gx = x - s, gy = y - s;
+			int in = gx >= 0 && gy >= 0 && gx < gw && gy < gh && src[gy * pitch + gx] >= 128;
+			int best = (s + 1) * (s + 1);
 
-		cx += (g->advance.x >> 6) * sx;
-		cy -= (g->advance.y >> 6) * sy;
+			for (int dy = -s; dy <= s; ++dy) {
+				for (int dx = -s; dx <= s; ++dx) {
+					int d2 = dx * dx + dy * dy;
+					if (d2 >= best) continue;
+
+					int ox = gx + dx, oy = gy + dy;
+					int other = ox >= 0 && oy >= 0 && ox < gw && oy < gh && src[oy * pitch + ox] >= 128;
+
+					if (other != in) best = d2;
+				}
+			}
+
+			/* the edge sits halfway between the two pixel centres */
+			float d = sqrtf(best) - 0.5f;
+			if (d > s) d = s;
+
+			float v = 0.5f + (in ? d : -d) / (2.0f * s);
+			dest[y * w + x] = v <= 0.0f ? 0 : v >= 1.0f ? 255 : (unsigned char) (v * 255.0f + 0.5f);
+		}
 	}
 }
 
+void tk_text_begin(void) {
+	batching = 1;
+}
+
+void tk_text_end(void) {
+	batching = 0;
+	tk_text_flush();
+}
+
+void tk_text_flush(void) {
+	if (!batch_len) return;
+
+	glUseProgram(batch_sdf ? prg_sdf : prg);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA); /* keeps alpha right when drawing into a clear target */
+	glBlendEquation(GL_FUNC_ADD);
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof batch, NULL, GL_STREAM_DRAW); /* orphan the last batch */
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof *batch * batch_len, batch);
+
+	glBindTexture(GL_TEXTURE_2D, batch_tex);
+	glDrawArrays(GL_TRIANGLES, 0, batch_len);
+
+	batch_len = 0;
+}
+
 void tk_text_free(void) {
 	if (!init) return;
 	init = 0;
 
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteProgram(prg);
+	glDeleteProgram(prg_sdf);
+
 	FT_Done_FreeType(ctx);
 }
 
@@ -172,34 +477,58 @@ void tk_text_init(void) {
 
 	vs = make_shader(tk_text_vs, GL_VERTEX_SHADER);
 	fs = make_shader(tk_text_fs, GL_FRAGMENT_SHADER);
+	fs_sdf = make_shader(tk_text_fs_sdf, GL_FRAGMENT_SHADER);
 
-	if (!vs || !fs) {
+	if (!vs || !fs || !fs_sdf) {
 		tk_die("Shader init fail.\n");
 	}
 
-	prg = glCreateProgram();
-	glAttachShader(prg, vs);
-	glAttachShader(prg, fs);
-	glLinkProgram(prg);
+	prg = tk_text_program(fs);
+	prg_sdf = tk_text_program(fs_sdf);
 
-	int st;
-	glGetProgramiv(prg, GL_LINK_STATUS, &st);
-	if (!st) {
+	if (!prg || !prg_sdf) {
 		tk_die("Program link fail.\n");
 	}
 
-	glUseProgram(prg);
-	loc_tex = glGetUniformLocation(prg, "tx");
-	glUniform1i(loc_tex, 0);
-	loc_col = glGetUniformLocation(prg, "c");
-	glUniform4f(loc_col, 1.0f, 1.0f, 1.0f, 1.0f);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+	glDeleteShader(fs_sdf);
+
 	glEnable(GL_BLEND);
 
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof batch, NULL, GL_STREAM_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(tk_vert), NULL);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(tk_vert), (void*) offsetof(tk_vert, u));
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(tk_vert), (void*) offsetof(tk_vert, col));
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(tk_vert), (void*) offsetof(tk_vert, ocol));
+	glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(tk_vert), (void*) offsetof(tk_vert, outline));
+
+	for (int i = 0; i < 5; ++i) glEnableVertexAttribArray(i);
+
 	init = 1;
 }
 
-float pixel_map(int p, int view) {
-	return ((float) p / (float) view) * 2.0f - 1.0f;
+unsigned int tk_text_program(unsigned int frag) {
+	unsigned int out = glCreateProgram();
+	glAttachShader(out, vs);
+	glAttachShader(out, frag);
+	glLinkProgram(out);
+
+	int st;
+	glGetProgramiv(out, GL_LINK_STATUS, &st);
+	if (!st) return 0;
+
+	glUniformBlockBinding(out, glGetUniformBlockIndex(out, "camera"), CAMERA_BINDING);
+
+	glUseProgram(out);
+	glUniform1i(glGetUniformLocation(out, "tx"), 0);
+
+	return out;
 }
 
 unsigned int make_shader(const char* source, GLenum type) {
@@ -219,10 +548,3 @@ unsigned int make_shader(const char* source, GLenum type) {
 
 	return out;
 }
-
-void tk_font_set_col(tk_font* p, float r, float g, float b, float a) {
-	p->col[0] = r;
-	p->col[1] = g;
-	p->col[2] = b;
-	p->col[3] = a;
-}
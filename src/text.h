@@ -10,21 +10,61 @@
 #define TK_TEXT_CENTER 1
 #define TK_TEXT_RIGHT (1 << 1)
 #define TK_TEXT_MAXLEN 128
+#define TK_TEXT_BATCH 4096 /* glyphs per draw */
+#define TK_TEXT_ATLAS_W 512 /* atlas width, the height grows to fit */
+#define TK_TEXT_SDF_SIZE 32 /* base size of every sdf atlas */
+#define TK_TEXT_SDF_SPREAD 6 /* base pixels of distance either side of the edge, caps outline width */
 
 #include <stdarg.h>
 
-typedef struct _tk_font {
+/* where a glyph sits in the atlas and how to place it, pixels except for the uvs */
+typedef struct _tk_glyph {
+	float u0, v0, u1, v1;
+	short w, h, left, top, advance;
+} tk_glyph;
+
+/* a loaded face and its atlas, shared by every tk_font opened with the same file and size */
+typedef struct _tk_face {
+	char* filename;
+	int size_px, sdf, refs;
 	FT_Face face;
-	int size_px;
+	unsigned int atlas;
+	int atlas_w, atlas_h;
+	tk_glyph glyphs[TK_TEXT_GLYPHS];
+	struct _tk_face* next;
+} tk_face;
+
+/* a handle is a shared face plus how to draw it, so one font in several colours or sizes costs nothing extra */
+typedef struct _tk_font {
+	tk_face* face;
+	int size_px; /* draw size, sdf faces scale cleanly to any size */
 	float col[4];
-	unsigned int glyphs[TK_TEXT_GLYPHS];
+	float outline, outline_col[4]; /* sdf only, width in pixels */
+	int shadow_x, shadow_y;
+	float shadow_col[4]; /* no shadow while alpha is 0 */
 } tk_font;
 
+/* a run of text in its own colour, NULL col uses the font's */
+typedef struct _tk_span {
+	const float* col;
+	const char* str;
+} tk_span;
+
 tk_font* tk_font_init(const char* filename, int size);
+tk_font* tk_font_init_sdf(const char* filename, int size); /* every sdf handle on a file shares one TK_TEXT_SDF_SIZE atlas */
 void tk_font_free(tk_font* dest);
 
 /* x, y treated as pixel-space vector from the lower-left origin to the lower-left corner of the first glpyh */
 void tk_font_render(tk_font* p, int x, int y, int flags, const char* fmt, ...);
+void tk_font_render_col(tk_font* p, const float* col, int x, int y, int flags, const char* fmt, ...); /* col overrides the font's for this draw, NULL keeps it */
+void tk_font_render_spans(tk_font* p, int x, int y, int flags, const tk_span* spans, int count); /* flags align the spans as one string */
 void tk_font_set_col(tk_font* p, float r, float g, float b, float a);
+void tk_font_set_size(tk_font* p, int size);
+void tk_font_set_outline(tk_font* p, float width, float r, float g, float b, float a);
+void tk_font_set_shadow(tk_font* p, int dx, int dy, float r, float g, float b, float a);
+
+/* everything rendered between begin and end is laid out into one vertex buffer and drawn at end (or when the face changes) */
+void tk_text_begin(void);
+void tk_text_end(void);
 
 void tk_text_free(void);
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <math.h>
 #include <time.h>
+#include <getopt.h>
 
 #include <GLXW/glxw.h>
 #include <GLFW/glfw3.h>
@@ -19,20 +20,167 @@
 #include "linmath.h"
 
 #include "demo_pretex.h"
+#include "demo_tilemap.h"
+#include "chunktab.h"
+#include "linmath_bench.h"
+#include "world.h"
+#include "bench.h"
+#include "timer.h"
+#include "overlay.h"
 #include "tileproto.h"
 
 #define FS 1
 
+#define HACCEL 0.08f
+#define HMAX 0.8f
+#define VACCEL 0.08f
+#define VMAX 0.8f
+#define DECAY 1.2f
+
+#define GEN_REGIONS 4 /* --genworld writes GEN_REGIONS x GEN_REGIONS region files */
+#define GEN_TYPES 4 /* empty plus the builtin blocks */
+
+/* std140 layout of CAMERA_BLOCK */
+typedef struct _camera_block {
+	mat4x4 viewproj, screen;
+	float view[4], viewport[2], pad[2];
+} camera_block;
+
+typedef struct _demo {
+	const char* name;
+	int (*render)(void);
+	void (*free)(void);
+} demo;
+
+static const demo demos[] = {
+	{ "pretex", demo_pretex_render, demo_pretex_free },
+	{ "tilemap", demo_tilemap_render, demo_tilemap_free },
+};
+
 GLFWwindow* wh;
-unsigned int prg, vs, fs, loc_xform, loc_tex;
+unsigned int prg, vs, fs, loc_tex;
+unsigned screen_fbo;
+static unsigned screen_tex, camera_ubo;
 
-float camera[4] = {0.0f, 0.0f, CAMERASIZE*RATIO, CAMERASIZE}; /* adjust width for ratio */
-mat4x4 model, view, proj;
+int opt_workers = 0;
+const char* opt_blockdir = NULL;
+const char* opt_frame_csv = NULL;
+float opt_hud_rate = OVERLAY_RATE;
+float opt_edit_stress = 0.0f;
+float opt_zoom = 1.0f;
 
-unsigned int make_shader(const char* source, GLenum type);
-void update_mats(void);
+float camera[4] = {0.0f, 0.0f, CAMERASIZE*RATIO, CAMERASIZE}; /* adjust width for ratio */
+mat4x4 view, proj;
+
+float camerax, cameray;
+float cxspeed, cyspeed;
+
+static const struct option options[] = {
+	{ "bench-chunktab", no_argument, NULL, 'T' },
+	{ "bench-linmath", no_argument, NULL, 'M' },
+	{ "workers", required_argument, NULL, 'j' },
+	{ "blockdir", required_argument, NULL, 'B' },
+	{ "demo", required_argument, NULL, 'd' },
+	{ "world", required_argument, NULL, 'W' },
+	{ "genworld", required_argument, NULL, 'G' },
+	{ "seed", required_argument, NULL, 'S' },
+	{ "bench", required_argument, NULL, 'b' },
+	{ "bench-frames", required_argument, NULL, 'F' },
+	{ "bench-out", required_argument, NULL, 'O' },
+	{ "baseline", required_argument, NULL, 'L' },
+	{ "bench-tolerance", required_argument, NULL, 'P' },
+	{ "frame-csv", required_argument, NULL, 'C' },
+	{ "trace", required_argument, NULL, 'R' },
+	{ "hud-rate", required_argument, NULL, 'H' },
+	{ "edit-stress", required_argument, NULL, 'E' },
+	{ "zoom", required_argument, NULL, 'Z' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static int make_screen_fbo(void);
 
 int main(int argc, char** argv) {
+	const demo* active = demos;
+	const char* opt_world = NULL, *opt_genworld = NULL;
+	const char* opt_bench = NULL, *opt_bench_out = NULL, *opt_baseline = NULL, *opt_trace = NULL;
+	float opt_tolerance = BENCH_TOLERANCE;
+	int opt, opt_frames = 0, seeded = 0;
+	while ((opt = getopt_long(argc, argv, "j:", options, NULL)) != -1) {
+		switch (opt) {
+		case 'T':
+			return chunktab_bench();
+		case 'M':
+			return linmath_bench();
+		case 'j':
+			opt_workers = atoi(optarg);
+			break;
+		case 'B':
+			opt_blockdir = optarg;
+			break;
+		case 'd':
+			for (active = demos; active < demos + sizeof demos / sizeof *demos; ++active) {
+				if (!strcmp(active->name, optarg)) break;
+			}
+			if (active < demos + sizeof demos / sizeof *demos) break;
+			printf("unknown demo: %s (pretex, tilemap)\n", optarg);
+			return 1;
+		case 'W':
+			opt_world = optarg;
+			break;
+		case 'G':
+			opt_genworld = optarg;
+			break;
+		case 'S':
+			world_seed(strtoul(optarg, NULL, 0));
+			seeded = 1;
+			break;
+		case 'b':
+			opt_bench = optarg;
+			break;
+		case 'F':
+			opt_frames = atoi(optarg);
+			break;
+		case 'O':
+			opt_bench_out = optarg;
+			break;
+		case 'L':
+			opt_baseline = optarg;
+			break;
+		case 'P':
+			opt_tolerance = atof(optarg);
+			break;
+		case 'C':
+			opt_frame_csv = optarg;
+			break;
+		case 'R':
+			opt_trace = optarg;
+			break;
+		case 'H':
+			opt_hud_rate = atof(optarg);
+			break;
+		case 'E':
+			opt_edit_stress = atof(optarg);
+			break;
+		case 'Z':
+			opt_zoom = atof(optarg);
+			break;
+		default:
+			printf("usage: %s [--demo pretex|tilemap] [-j|--workers N] [--blockdir DIR] [--world DIR] [--genworld DIR] [--seed N] [--frame-csv FILE] [--trace FILE] [--hud-rate HZ] [--edit-stress N] [--zoom Z] [--bench-chunktab] [--bench-linmath]\n", argv[0]);
+			printf("       [--bench pan,diagonal,teleport,jitter|all] [--bench-frames N] [--bench-out FILE] [--baseline FILE] [--bench-tolerance PCT]\n");
+			return 1;
+		}
+	}
+
+	if (opt_genworld) return world_generate(opt_genworld, GEN_REGIONS, GEN_TYPES);
+	if (opt_world && world_open(opt_world)) return 1;
+
+	if (opt_bench) {
+		if (bench_init(opt_bench, opt_frames)) return 1;
+		if (!seeded) world_seed(1); /* same world every run */
+	}
+
+	TIMER_THREAD("main");
+
 	if (!glfwInit()) return 1;
 
 	srand(time(NULL));
@@ -42,12 +190,20 @@ int main(int argc, char** argv) {
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-	wh = glfwCreateWindow(WIDTH, HEIGHT, "tileproto", FS ? glfwGetPrimaryMonitor() : NULL, NULL);
+	/* benches run in a hidden window and draw offscreen, so they work on headless boxes (under Xvfb, llvmpipe is fine) */
+	if (opt_bench) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	wh = glfwCreateWindow(WIDTH, HEIGHT, "tileproto", FS && !opt_bench ? glfwGetPrimaryMonitor() : NULL, NULL);
 	if (!wh) return 2;
 
 	glfwMakeContextCurrent(wh);
 	if (glxwInit()) return 3;
 
+	if (opt_bench) {
+		glfwSwapInterval(0); /* don't measure vsync */
+		if (make_screen_fbo()) return 7;
+	}
+
 	glViewport(0, 0, WIDTH, HEIGHT);
 
 	/* this won't require any special shaders, set up a quick passthrough */
@@ -57,46 +213,78 @@ int main(int argc, char** argv) {
 	fs = make_shader(fs_render, GL_FRAGMENT_SHADER);
 	if (!fs) return 5;
 
-	prg = glCreateProgram();
-	glAttachShader(prg, vs);
-	glAttachShader(prg, fs);
-	glLinkProgram(prg);
-
-	int status;
-	glGetProgramiv(prg, GL_LINK_STATUS, &status);
-	if (!status) {
-		char log[1024];
-		glGetProgramInfoLog(prg, 1023, NULL, log);
-		printf("prg fail: %s\n", log);
-		return 6;
-	}
+	prg = link_program(vs, fs);
+	if (!prg) return 6;
 
 	glUseProgram(prg);
 
-	loc_xform = glGetUniformLocation(prg, "transform");
 	loc_tex = glGetUniformLocation(prg, "tex");
 
 	glUniform1i(loc_tex, 0); /* prep texture unit */
 	glActiveTexture(GL_TEXTURE0);
 
-	mat4x4_identity(model);
+	/* one camera block for every shader, rewritten once per frame */
+	glGenBuffers(1, &camera_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, camera_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(camera_block), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING, camera_ubo);
+
 	mat4x4_identity(view);
-	update_mats();
+	camera_upload();
 
 	/* shaders prepped, start up the mainloop */
 	while (!glfwWindowShouldClose(wh)) {
+		tp frame_tp = timer_get();
+
 		glfwPollEvents();
 		if (glfwGetKey(wh, GLFW_KEY_ESCAPE)) break;
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		glUseProgram(prg);
 
-		if (demo_pretex_render()) break;
+		if (active->render()) break;
 		glfwSwapBuffers(wh);
+
+		if (opt_bench) {
+			glFinish(); /* count the GPU's share of the frame too */
+			bench_frame(timer_diff(frame_tp));
+			if (bench_done()) break;
+		}
+	}
+
+	active->free(); /* joins the workers, so every zone is in */
+	world_close();
+	glDeleteBuffers(1, &camera_ubo);
+
+	if (opt_trace) timer_trace_write(opt_trace);
+
+	int ret = 0;
+
+	if (opt_bench) {
+		ret = bench_report(active->name, opt_bench_out, opt_baseline, opt_tolerance);
+		bench_free();
+		glDeleteFramebuffers(1, &screen_fbo);
+		glDeleteTextures(1, &screen_tex);
 	}
 
-	demo_pretex_free();
 	glfwTerminate();
+	return ret;
+}
+
+int make_screen_fbo(void) {
+	glGenTextures(1, &screen_tex);
+	glBindTexture(GL_TEXTURE_2D, screen_tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, WIDTH, HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	glGenFramebuffers(1, &screen_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, screen_fbo);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, screen_tex, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		printf("offscreen framebuffer incomplete\n");
+		return 1;
+	}
+
 	return 0;
 }
 
@@ -118,14 +306,94 @@ unsigned int make_shader(const char* source, GLenum type) {
 	return out;
 }
 
-void update_mats(void) {
-	/* recompute ortho+view camera matrices */
-	mat4x4 viewproj;
-	mat4x4_ortho(proj, camera[0], camera[0] + camera[2], camera[1], camera[1] + camera[3], -0.1f, 0.1f);
-	mat4x4_mul(viewproj, proj, view);
+unsigned int link_program(unsigned int vs, unsigned int fs) {
+	unsigned int out = glCreateProgram();
+	glAttachShader(out, vs);
+	glAttachShader(out, fs);
+	glLinkProgram(out);
+
+	int status;
+	glGetProgramiv(out, GL_LINK_STATUS, &status);
+	if (!status) {
+		char log[1024];
+		glGetProgramInfoLog(out, 1023, NULL, log);
+		printf("prg fail: %s\n", log);
+		return 0;
+	}
+
+	unsigned block = glGetUniformBlockIndex(out, "camera");
+	if (block != GL_INVALID_INDEX) glUniformBlockBinding(out, block, CAMERA_BINDING);
+
+	return out;
+}
+
+unsigned int make_program(const char* vs_source, const char* fs_source) {
+	unsigned int v = make_shader(vs_source, GL_VERTEX_SHADER);
+	unsigned int f = make_shader(fs_source, GL_FRAGMENT_SHADER);
+	unsigned int out = 0;
+
+	if (v && f) out = link_program(v, f);
+
+	/* flagged for deletion, they stay alive as long as the program does */
+	glDeleteShader(v);
+	glDeleteShader(f);
+	return out;
+}
 
-	mat4x4 final; /* ignoring the viewmat for now */
-	mat4x4_mul(final, viewproj, model);
+void camera_update(void) {
+	/* shared camera so every demo can be driven along the same path */
+	if (bench_active()) {
+		bench_camera(&camerax, &cameray, &cxspeed, &cyspeed);
+		mat4x4_translate(view, -camerax, -cameray, 0.0f);
+		camera_upload();
+		return;
+	}
 
-	glUniformMatrix4fv(loc_xform, 1, GL_FALSE, (float*) *final);
+	if (glfwGetKey(wh, GLFW_KEY_RIGHT)) {
+		cxspeed += HACCEL;
+	}
+
+	if (glfwGetKey(wh, GLFW_KEY_LEFT)) {
+		cxspeed -= HACCEL;
+	}
+
+	if (glfwGetKey(wh, GLFW_KEY_UP)) {
+		cyspeed += VACCEL;
+	}
+
+	if (glfwGetKey(wh, GLFW_KEY_DOWN)) {
+		cyspeed -= VACCEL;
+	}
+
+	if (fabs(cxspeed) > HMAX) cxspeed /= (fabs(cxspeed)/HMAX);
+	if (fabs(cyspeed) > VMAX) cyspeed /= (fabs(cyspeed)/VMAX);
+
+	camerax += cxspeed;
+	cameray += cyspeed;
+
+	cxspeed /= DECAY;
+	cyspeed /= DECAY;
+
+	mat4x4_translate(view, -camerax, -cameray, 0.0f);
+	camera_upload();
+}
+
+void camera_upload(void) {
+	/* the only matrix products of the frame, draws place themselves with offsets */
+	camera_block b;
+
+	mat4x4_ortho(proj, camera[0], camera[0] + camera[2], camera[1], camera[1] + camera[3], -0.1f, 0.1f);
+	mat4x4_mul(b.viewproj, proj, view);
+	mat4x4_ortho(b.screen, 0.0f, WIDTH, 0.0f, HEIGHT, -1.0f, 1.0f);
+
+	b.view[0] = camerax + camera[0];
+	b.view[1] = cameray + camera[1];
+	b.view[2] = camera[2];
+	b.view[3] = camera[3];
+	b.viewport[0] = WIDTH;
+	b.viewport[1] = HEIGHT;
+	b.pad[0] = b.pad[1] = 0.0f;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, camera_ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof b, &b);
 }
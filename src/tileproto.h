@@ -1,5 +1,6 @@
 #pragma once
 #include "linmath.h"
+#include "camera.h"
 
 #include <GLFW/glfw3.h>
 
@@ -8,10 +9,26 @@ extern GLFWwindow* wh;
 /* just some quick vars to allow program modules to easily work with the demo */
 
 extern float camera[4]; /* x, y, width, height */
-extern mat4x4 model, view, proj;
-extern unsigned loc_xform, prg;
+extern mat4x4 view, proj;
+extern unsigned prg; /* prg draws a textured quad in world units */
+extern unsigned screen_fbo; /* where demos draw the frame, 0 unless --bench renders offscreen */
 
-void update_mats(void);
+extern float camerax, cameray; /* world position of the lower-left corner of the view, in tiles */
+extern float cxspeed, cyspeed; /* tiles per frame */
+
+extern int opt_workers; /* chunk data worker threads, 0 for one per spare core */
+extern const char* opt_blockdir; /* extra directory of block textures, or NULL */
+extern const char* opt_frame_csv; /* where to dump frame times on exit, or NULL */
+extern float opt_hud_rate; /* HUD overlay redraws per second, 0 redraws on every change */
+extern float opt_edit_stress; /* random tile edits per second in the pretex demo, 0 for none */
+extern float opt_zoom; /* starting zoom of the pretex demo, 1 shows CAMERASIZE tiles high */
+
+void camera_update(void); /* apply input to the camera and upload the camera block, once per frame */
+void camera_upload(void);
+
+unsigned int make_shader(const char* source, GLenum type);
+unsigned int link_program(unsigned int vs, unsigned int fs);
+unsigned int make_program(const char* vs_source, const char* fs_source); /* 0 on failure */
 
 #define WIDTH 1366
 #define HEIGHT 768
@@ -1,5 +1,7 @@
 #include "timer.h"
 
+#include <stdlib.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <time.h>
 
@@ -14,3 +16,146 @@ float timer_diff(tp ref) {
 	tp diff = cur - ref;
 	return ((float) diff / 1000000);
 }
+
+#ifdef TIMER_PROFILE
+
+typedef struct _timer_zone {
+	const char* name;
+	tp start, end;
+	int kind, a, b;
+} timer_zone;
+
+typedef struct _timer_ring {
+	timer_zone zones[TIMER_RING];
+	timer_zone stack[TIMER_DEPTH]; /* open zones */
+	unsigned head; /* total zones written, only the owning thread stores it */
+	int depth, id;
+	const char* name;
+} timer_ring;
+
+static timer_ring* rings[TIMER_THREADS];
+static int nrings;
+static __thread timer_ring* ring;
+static __thread int ring_failed;
+
+static timer_ring* timer_ring_get(void) {
+	if (ring || ring_failed) return ring;
+
+	/* first zone on this thread, claim a slot. this is the only allocation and happens once per thread */
+	int id = __atomic_fetch_add(&nrings, 1, __ATOMIC_RELAXED);
+	timer_ring* r = id < TIMER_THREADS ? calloc(1, sizeof *r) : NULL;
+
+	if (!r) {
+		ring_failed = 1;
+		return NULL;
+	}
+
+	r->id = id;
+	__atomic_store_n(&rings[id], r, __ATOMIC_RELEASE);
+	return ring = r;
+}
+
+void timer_zone_begin(const char* name, int kind, int a, int b) {
+	timer_ring* r = timer_ring_get();
+	if (!r) return;
+
+	if (r->depth < TIMER_DEPTH) {
+		timer_zone* z = r->stack + r->depth;
+		z->name = name;
+		z->kind = kind;
+		z->a = a;
+		z->b = b;
+		z->start = timer_get();
+	}
+
+	r->depth++;
+}
+
+void timer_zone_end(void) {
+	timer_ring* r = ring;
+	if (!r || !r->depth) return;
+
+	if (--r->depth >= TIMER_DEPTH) return;
+
+	timer_zone* z = r->stack + r->depth;
+	z->end = timer_get();
+
+	unsigned head = r->head;
+	r->zones[head & (TIMER_RING - 1)] = *z;
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void timer_thread_name(const char* name) {
+	timer_ring* r = timer_ring_get();
+	if (r) r->name = name;
+}
+
+int timer_trace_write(const char* filename) {
+	FILE* f = fopen(filename, "w");
+	if (!f) {
+		printf("timer: can't write %s\n", filename);
+		return 1;
+	}
+
+	int n = __atomic_load_n(&nrings, __ATOMIC_ACQUIRE);
+	if (n > TIMER_THREADS) n = TIMER_THREADS;
+
+	unsigned total = 0;
+	tp base = ~(tp) 0;
+
+	/* timestamps are relative to the earliest zone so the trace starts at 0 */
+	for (int i = 0; i < n; ++i) {
+		timer_ring* r = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+		if (!r) continue;
+
+		unsigned head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		unsigned first = head > TIMER_RING ? head - TIMER_RING : 0;
+
+		for (unsigned j = first; j < head; ++j) {
+			if (r->zones[j & (TIMER_RING - 1)].start < base) base = r->zones[j & (TIMER_RING - 1)].start;
+		}
+	}
+
+	fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+
+	for (int i = 0; i < n; ++i) {
+		timer_ring* r = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+		if (!r) continue;
+
+		fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s %d\"}}", total++ ? ",\n" : "", r->id, r->name ? r->name : "thread", r->id);
+
+		unsigned head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		unsigned first = head > TIMER_RING ? head - TIMER_RING : 0;
+
+		for (unsigned j = first; j < head; ++j) {
+			timer_zone* z = r->zones + (j & (TIMER_RING - 1));
+
+			fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f", z->name, r->id, (z->start - base) / 1000.0, (z->end - z->start) / 1000.0);
+
+			if (z->kind == TIMER_ARGS_CHUNK) fprintf(f, ", \"args\": {\"cx\": %d, \"cy\": %d}", z->a, z->b);
+			if (z->kind == TIMER_ARGS_FRAME) fprintf(f, ", \"args\": {\"frame\": %d}", z->a);
+
+			fprintf(f, "}");
+			total++;
+		}
+	}
+
+	fprintf(f, "\n]}\n");
+	fclose(f);
+
+	printf("timer: wrote %u trace events from %d threads to %s\n", total, n, filename);
+	return 0;
+}
+
+#else
+
+void timer_zone_begin(const char* name, int kind, int a, int b) {}
+void timer_zone_end(void) {}
+void timer_thread_name(const char* name) {}
+
+int timer_trace_write(const char* filename) {
+	printf("timer: built without TIMER_PROFILE (make PROFILE=1), no trace written\n");
+	return 1;
+}
+
+#endif
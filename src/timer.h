@@ -5,3 +5,43 @@ typedef uint64_t tp;
 
 tp timer_get(void);
 float timer_diff(tp ref); /* in ms */
+
+/*
+ * zone profiler
+ *
+ * TIMER_ZONE_BEGIN/END bracket a named span on the calling thread. completed zones go
+ * into a lock-free ring owned by that thread (oldest overwritten when full) and are
+ * written out as a Chrome/Perfetto trace with timer_trace_write.
+ * the macros compile to nothing unless built with -DTIMER_PROFILE (make PROFILE=1).
+ * names must be string literals, zones must nest properly within a thread.
+ */
+
+#define TIMER_RING (1 << 15) /* zones kept per thread */
+#define TIMER_DEPTH 32 /* max nesting per thread */
+#define TIMER_THREADS 72 /* max threads that can record zones */
+
+#ifdef TIMER_PROFILE
+#define TIMER_ZONE_BEGIN(name) timer_zone_begin(name, TIMER_ARGS_NONE, 0, 0)
+#define TIMER_ZONE_BEGIN_CHUNK(name, cx, cy) timer_zone_begin(name, TIMER_ARGS_CHUNK, cx, cy)
+#define TIMER_ZONE_BEGIN_FRAME(name, frame) timer_zone_begin(name, TIMER_ARGS_FRAME, frame, 0)
+#define TIMER_ZONE_END() timer_zone_end()
+#define TIMER_THREAD(name) timer_thread_name(name)
+#else
+#define TIMER_ZONE_BEGIN(name) ((void) 0)
+#define TIMER_ZONE_BEGIN_CHUNK(name, cx, cy) ((void) 0)
+#define TIMER_ZONE_BEGIN_FRAME(name, frame) ((void) 0)
+#define TIMER_ZONE_END() ((void) 0)
+#define TIMER_THREAD(name) ((void) 0)
+#endif
+
+enum {
+	TIMER_ARGS_NONE,
+	TIMER_ARGS_CHUNK, /* a, b: chunk x, y */
+	TIMER_ARGS_FRAME, /* a: frame number */
+};
+
+void timer_zone_begin(const char* name, int kind, int a, int b);
+void timer_zone_end(void);
+void timer_thread_name(const char* name); /* label for the calling thread in the trace */
+
+int timer_trace_write(const char* filename); /* call once every recording thread has stopped */
@@ -0,0 +1,232 @@
+#include "wcache.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#define WCACHE_TILES (CHUNKSIZE * CHUNKSIZE)
+#define WCACHE_PALSLOTS 2048 /* open-addressed palette lookup while compressing, > WCACHE_TILES */
+
+typedef struct _wcache_entry {
+	int cx, cy;
+	struct _wcache_entry* hnext; /* bucket chain */
+	struct _wcache_entry* prev, *next; /* lru list, head is most recent */
+	unsigned size; /* bytes including this header */
+	uint16_t npal;
+	uint8_t bits; /* per index, 0 when the whole chunk is one tile */
+	uint32_t data[]; /* packed indices, then the palette */
+} wcache_entry;
+
+static wcache_entry** buckets;
+static wcache_entry* lru_head, *lru_tail;
+static wcache_stats stats;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned wcache_bucket(int cx, int cy);
+static wcache_entry* wcache_compress(int cx, int cy, const tile_t* tiles);
+static void wcache_unlink(wcache_entry* e);
+static void wcache_push_front(wcache_entry* e);
+
+int wcache_init(size_t budget) {
+	buckets = calloc(WCACHE_BUCKETS, sizeof *buckets);
+	if (!buckets) return 1;
+
+	memset(&stats, 0, sizeof stats);
+	stats.budget = budget;
+
+	printf("wcache: %zu KB budget\n", budget / 1024);
+	return 0;
+}
+
+void wcache_free(void) {
+	wcache_entry* e = lru_head;
+
+	while (e) {
+		wcache_entry* next = e->next;
+		free(e);
+		e = next;
+	}
+
+	free(buckets);
+	buckets = NULL;
+	lru_head = lru_tail = NULL;
+}
+
+int wcache_get(int cx, int cy, tile_t* dest) {
+	if (!buckets) return 0;
+
+	pthread_mutex_lock(&lock);
+
+	wcache_entry* e = buckets[wcache_bucket(cx, cy)];
+	while (e && (e->cx != cx || e->cy != cy)) e = e->hnext;
+
+	if (!e) {
+		stats.misses++;
+		pthread_mutex_unlock(&lock);
+		return 0;
+	}
+
+	stats.hits++;
+	wcache_unlink(e);
+	wcache_push_front(e);
+
+	/* decompressed under the lock, so a concurrent put can't evict the entry underneath us */
+	const tile_t* pal = (const tile_t*) (e->data + (WCACHE_TILES * e->bits + 31) / 32);
+
+	if (!e->bits) {
+		for (int i = 0; i < WCACHE_TILES; ++i) dest[i] = pal[0];
+	} else {
+		unsigned per = 32 / e->bits, mask = (1u << e->bits) - 1;
+
+		for (int w = 0, i = 0; i < WCACHE_TILES; ++w) {
+			uint32_t word = e->data[w];
+			for (unsigned k = 0; k < per && i < WCACHE_TILES; ++k, word >>= e->bits) {
+				dest[i++] = pal[word & mask];
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&lock);
+	return 1;
+}
+
+void wcache_put(int cx, int cy, const tile_t* tiles) {
+	if (!buckets) return;
+
+	/* compress outside the lock, that's the expensive part */
+	wcache_entry* n = wcache_compress(cx, cy, tiles);
+	if (!n) return;
+
+	pthread_mutex_lock(&lock);
+
+	wcache_entry** link = buckets + wcache_bucket(cx, cy);
+	while (*link && ((*link)->cx != cx || (*link)->cy != cy)) link = &(*link)->hnext;
+
+	if (*link) {
+		/* another worker got here first, swap in the newer copy */
+		wcache_entry* old = *link;
+		*link = old->hnext;
+		wcache_unlink(old);
+		stats.entries--;
+		stats.bytes -= old->size;
+		stats.raw_bytes -= WCACHE_TILES * sizeof(tile_t);
+		free(old);
+	}
+
+	n->hnext = buckets[wcache_bucket(cx, cy)];
+	buckets[wcache_bucket(cx, cy)] = n;
+	wcache_push_front(n);
+
+	stats.entries++;
+	stats.bytes += n->size;
+	stats.raw_bytes += WCACHE_TILES * sizeof(tile_t);
+
+	while (stats.bytes > stats.budget && lru_tail != n) {
+		wcache_entry* e = lru_tail;
+
+		for (link = buckets + wcache_bucket(e->cx, e->cy); *link != e; link = &(*link)->hnext);
+		*link = e->hnext;
+
+		wcache_unlink(e);
+		stats.entries--;
+		stats.evictions++;
+		stats.bytes -= e->size;
+		stats.raw_bytes -= WCACHE_TILES * sizeof(tile_t);
+		free(e);
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+wcache_stats wcache_get_stats(void) {
+	pthread_mutex_lock(&lock);
+	wcache_stats s = stats;
+	pthread_mutex_unlock(&lock);
+	return s;
+}
+
+wcache_entry* wcache_compress(int cx, int cy, const tile_t* tiles) {
+	uint16_t slot_id[WCACHE_PALSLOTS], slot_idx[WCACHE_PALSLOTS];
+	uint8_t slot_used[WCACHE_PALSLOTS] = {0};
+	uint16_t idx[WCACHE_TILES];
+	tile_t pal[WCACHE_TILES];
+	unsigned npal = 0;
+
+	for (int i = 0; i < WCACHE_TILES; ++i) {
+		unsigned h = (tiles[i] * 0x9e37u) & (WCACHE_PALSLOTS - 1);
+
+		while (slot_used[h] && slot_id[h] != tiles[i]) h = (h + 1) & (WCACHE_PALSLOTS - 1);
+
+		if (!slot_used[h]) {
+			slot_used[h] = 1;
+			slot_id[h] = tiles[i];
+			slot_idx[h] = npal;
+			pal[npal++] = tiles[i];
+		}
+
+		idx[i] = slot_idx[h];
+	}
+
+	/* only power of two widths, so an index never straddles two words */
+	unsigned bits = 0;
+	if (npal > 1) {
+		bits = 1;
+		while ((1u << bits) < npal) bits <<= 1;
+	}
+
+	unsigned words = (WCACHE_TILES * bits + 31) / 32;
+	unsigned size = sizeof(wcache_entry) + words * sizeof(uint32_t) + npal * sizeof(tile_t);
+
+	wcache_entry* e = calloc(1, size);
+	if (!e) return NULL;
+
+	e->cx = cx;
+	e->cy = cy;
+	e->size = size;
+	e->npal = npal;
+	e->bits = bits;
+
+	if (bits) {
+		unsigned per = 32 / bits;
+		for (int i = 0; i < WCACHE_TILES; ++i) {
+			e->data[i / per] |= (uint32_t) idx[i] << (i % per * bits);
+		}
+	}
+
+	memcpy(e->data + words, pal, npal * sizeof(tile_t));
+	return e;
+}
+
+unsigned wcache_bucket(int cx, int cy) {
+	/* murmur3 finalizer, same reasoning as chunktab */
+	uint64_t k = (uint64_t) (uint32_t) cx << 32 | (uint32_t) cy;
+
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+
+	return k & (WCACHE_BUCKETS - 1);
+}
+
+void wcache_unlink(wcache_entry* e) {
+	if (e->prev) e->prev->next = e->next;
+	else lru_head = e->next;
+
+	if (e->next) e->next->prev = e->prev;
+	else lru_tail = e->prev;
+
+	e->prev = e->next = NULL;
+}
+
+void wcache_push_front(wcache_entry* e) {
+	e->prev = NULL;
+	e->next = lru_head;
+
+	if (lru_head) lru_head->prev = e;
+	lru_head = e;
+
+	if (!lru_tail) lru_tail = e;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stddef.h>
+
+#include "defs.h"
+
+/*
+ * wcache
+ *
+ * CPU-side cache of chunk tile data kept palette-compressed: each chunk stores the
+ * distinct tile ids it uses plus one bit-packed palette index per tile, at 0, 1, 2, 4, 8
+ * or 16 bits depending on how many distinct ids there are. a typical chunk fits in a
+ * few hundred bytes, so a large radius around the camera stays resident in a few MB.
+ * least recently used chunks are dropped once the byte budget is exceeded.
+ * get/put are safe to call from worker threads.
+ */
+
+#define WCACHE_BUCKETS 4096 /* hash buckets, power of two */
+
+typedef struct _wcache_stats {
+	unsigned entries, hits, misses, evictions;
+	size_t bytes, budget, raw_bytes; /* raw_bytes: what the cached chunks would take uncompressed */
+} wcache_stats;
+
+int wcache_init(size_t budget); /* budget in bytes, including per-entry overhead */
+void wcache_free(void);
+
+int wcache_get(int cx, int cy, tile_t* dest); /* nonzero and fills CHUNKSIZE*CHUNKSIZE tiles on a hit */
+void wcache_put(int cx, int cy, const tile_t* tiles); /* replaces any cached copy */
+
+wcache_stats wcache_get_stats(void);
@@ -0,0 +1,277 @@
+#include "world.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "defs.h"
+#include "region.h"
+#include "wcache.h"
+
+#define WORLD_CACHE_BYTES (4 << 20) /* palette-compressed chunks kept in memory */
+#define WORLD_EDIT_SLOTS 256 /* starting slots of the edited chunk table, doubled when 3/4 full */
+
+/* an edited chunk, the only copy of its tiles from the first edit on */
+typedef struct _world_edit {
+	int cx, cy;
+	int dirty[4]; /* tiles edited since the last world_next_dirty, empty when x1 is 0 */
+	struct _world_edit* next_dirty;
+	tile_t tiles[CHUNKSIZE * CHUNKSIZE];
+} world_edit;
+
+static int world_types = 1, world_stored, seeded, cached;
+static unsigned world_seedv;
+static const tile_t world_empty[CHUNKSIZE * CHUNKSIZE];
+static world_edit** edits, *dirty_head; /* open addressing, edits are never removed before world_close */
+static unsigned edit_cap, edit_count;
+static pthread_mutex_t edit_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const tile_t* world_source(int cx, int cy, tile_t* scratch);
+static world_edit* world_get_edit(int cx, int cy, int create);
+static unsigned world_edit_slot(world_edit** slots, unsigned cap, int cx, int cy);
+static int world_chunk_of(int t);
+static void world_gen_chunk(int cx, int cy, tile_t* dest);
+
+void world_init(int types) {
+	world_types = types > 0 ? types : 1;
+	if (!seeded) world_seed(rand());
+	if (!cached) cached = !wcache_init(WORLD_CACHE_BYTES); /* unused once a world is open */
+}
+
+void world_seed(unsigned seed) {
+	world_seedv = seed;
+	seeded = 1;
+	printf("world: seed %u\n", seed);
+}
+
+int world_open(const char* dir) {
+	if (region_open(dir)) return 1;
+	world_stored = 1;
+	return 0;
+}
+
+void world_close(void) {
+	for (unsigned i = 0; i < edit_cap; ++i) free(edits[i]);
+
+	free(edits);
+	edits = NULL;
+	edit_cap = edit_count = 0;
+
+	dirty_head = NULL;
+	region_close();
+	wcache_free();
+	world_stored = cached = 0;
+}
+
+const tile_t* world_query(int cx, int cy, tile_t* scratch) {
+	/* edits win over everything else, they only exist in memory */
+	pthread_mutex_lock(&edit_lock);
+	world_edit* e = world_get_edit(cx, cy, 0);
+	if (e) memcpy(scratch, e->tiles, sizeof e->tiles);
+	pthread_mutex_unlock(&edit_lock);
+
+	return e ? scratch : world_source(cx, cy, scratch);
+}
+
+void world_set_tile(int tx, int ty, tile_t id) {
+	world_fill_rect(tx, ty, 1, 1, id);
+}
+
+void world_fill_rect(int tx, int ty, int w, int h, tile_t id) {
+	if (w <= 0 || h <= 0) return;
+
+	int cx0 = world_chunk_of(tx), cx1 = world_chunk_of(tx + w - 1);
+	int cy0 = world_chunk_of(ty), cy1 = world_chunk_of(ty + h - 1);
+
+	pthread_mutex_lock(&edit_lock);
+
+	for (int cy = cy0; cy <= cy1; ++cy) {
+		for (int cx = cx0; cx <= cx1; ++cx) {
+			world_edit* e = world_get_edit(cx, cy, 1);
+			if (!e) continue;
+
+			/* the part of the rect inside this chunk */
+			int x0 = tx - cx * CHUNKSIZE, y0 = ty - cy * CHUNKSIZE, x1 = x0 + w, y1 = y0 + h;
+
+			if (x0 < 0) x0 = 0;
+			if (y0 < 0) y0 = 0;
+			if (x1 > CHUNKSIZE) x1 = CHUNKSIZE;
+			if (y1 > CHUNKSIZE) y1 = CHUNKSIZE;
+
+			for (int y = y0; y < y1; ++y) {
+				for (int x = x0; x < x1; ++x) e->tiles[x + y * CHUNKSIZE] = id;
+			}
+
+			/* edits are coalesced into one rect per chunk until it is popped */
+			if (!e->dirty[2]) {
+				e->dirty[0] = x0;
+				e->dirty[1] = y0;
+				e->dirty[2] = x1;
+				e->dirty[3] = y1;
+				e->next_dirty = dirty_head;
+				dirty_head = e;
+			} else {
+				if (x0 < e->dirty[0]) e->dirty[0] = x0;
+				if (y0 < e->dirty[1]) e->dirty[1] = y0;
+				if (x1 > e->dirty[2]) e->dirty[2] = x1;
+				if (y1 > e->dirty[3]) e->dirty[3] = y1;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&edit_lock);
+}
+
+int world_next_dirty(int* cx, int* cy, int* rect) {
+	pthread_mutex_lock(&edit_lock);
+	world_edit* e = dirty_head;
+
+	if (e) {
+		dirty_head = e->next_dirty;
+		*cx = e->cx;
+		*cy = e->cy;
+		memcpy(rect, e->dirty, sizeof e->dirty);
+		e->dirty[2] = 0;
+	}
+
+	pthread_mutex_unlock(&edit_lock);
+	return e != NULL;
+}
+
+const tile_t* world_source(int cx, int cy, tile_t* scratch) {
+	/* stored chunks are a pointer into the mapped file already, only generated ones are worth caching */
+	if (world_stored) {
+		const tile_t* tiles = region_chunk(cx, cy);
+		return tiles ? tiles : world_empty;
+	}
+
+	if (wcache_get(cx, cy, scratch)) return scratch;
+
+	world_gen_chunk(cx, cy, scratch);
+	wcache_put(cx, cy, scratch);
+	return scratch;
+}
+
+int world_generate(const char* dir, int regions, int types) {
+	world_init(types);
+	mkdir(dir, 0755);
+
+	tile_t* tiles = malloc(REGION_CHUNKS * REGION_CHUNKS * CHUNKSIZE * CHUNKSIZE * sizeof *tiles);
+	if (!tiles) return 1;
+
+	for (int ry = 0; ry < regions; ++ry) {
+		for (int rx = 0; rx < regions; ++rx) {
+			for (int i = 0; i < REGION_CHUNKS * REGION_CHUNKS; ++i) {
+				world_gen_chunk(rx * REGION_CHUNKS + i % REGION_CHUNKS, ry * REGION_CHUNKS + i / REGION_CHUNKS, tiles + i * CHUNKSIZE * CHUNKSIZE);
+			}
+
+			if (region_write(dir, rx, ry, tiles)) {
+				free(tiles);
+				return 1;
+			}
+		}
+	}
+
+	free(tiles);
+	printf("world: wrote %dx%d regions (%dx%d chunks) to %s\n", regions, regions, regions * REGION_CHUNKS, regions * REGION_CHUNKS, dir);
+	return 0;
+}
+
+world_edit* world_get_edit(int cx, int cy, int create) {
+	/* caller holds edit_lock */
+	unsigned i = edit_cap ? world_edit_slot(edits, edit_cap, cx, cy) : 0;
+
+	if (edit_cap && edits[i]) return edits[i];
+	if (!create) return NULL;
+
+	/* grow before the probe chains get long, the records themselves don't move */
+	if ((edit_count + 1) * 4 > edit_cap * 3) {
+		unsigned cap = edit_cap ? edit_cap * 2 : WORLD_EDIT_SLOTS;
+		world_edit** next = calloc(cap, sizeof *next);
+
+		if (!next) {
+			printf("world: out of memory growing the edit table to %u chunks\n", cap);
+			return NULL;
+		}
+
+		for (unsigned j = 0; j < edit_cap; ++j) {
+			if (edits[j]) next[world_edit_slot(next, cap, edits[j]->cx, edits[j]->cy)] = edits[j];
+		}
+
+		free(edits);
+		edits = next;
+		edit_cap = cap;
+		i = world_edit_slot(edits, edit_cap, cx, cy);
+	}
+
+	world_edit* e = malloc(sizeof *e);
+	if (!e) {
+		printf("world: out of memory editing chunk %d, %d\n", cx, cy);
+		return NULL;
+	}
+
+	e->cx = cx;
+	e->cy = cy;
+	e->dirty[2] = 0;
+
+	const tile_t* tiles = world_source(cx, cy, e->tiles);
+	if (tiles != e->tiles) memcpy(e->tiles, tiles, sizeof e->tiles);
+
+	edits[i] = e;
+	edit_count++;
+	return e;
+}
+
+unsigned world_edit_slot(world_edit** slots, unsigned cap, int cx, int cy) {
+	/* the slot holding cx, cy or the empty one it would go in, cap is a power of two */
+	uint64_t k = ((uint64_t) (uint32_t) cx << 32) | (uint32_t) cy;
+
+	/* murmur3 finalizer, neighbouring chunks differ only in the low bits of each half */
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+
+	unsigned i = k & (cap - 1);
+	while (slots[i] && (slots[i]->cx != cx || slots[i]->cy != cy)) i = (i + 1) & (cap - 1);
+	return i;
+}
+
+unsigned world_edited(size_t* bytes) {
+	pthread_mutex_lock(&edit_lock);
+	unsigned n = edit_count;
+	if (bytes) *bytes = n * sizeof(world_edit) + edit_cap * sizeof *edits;
+	pthread_mutex_unlock(&edit_lock);
+	return n;
+}
+
+int world_chunk_of(int t) {
+	return t >= 0 ? t / CHUNKSIZE : (t + 1) / CHUNKSIZE - 1;
+}
+
+void world_gen_chunk(int cx, int cy, tile_t* dest) {
+	/*
+	 * every chunk gets its own generator state from the seed and its coordinates,
+	 * so the result doesn't depend on which thread asks or in what order.
+	 */
+
+	uint64_t s = ((uint64_t) (uint32_t) cx << 32 | (uint32_t) cy) ^ (world_seedv * 0x9e3779b97f4a7c15ULL);
+
+	/* murmur3 finalizer to spread the coordinates over the whole state */
+	s ^= s >> 33;
+	s *= 0xff51afd7ed558ccdULL;
+	s ^= s >> 33;
+	s *= 0xc4ceb9fe1a85ec53ULL;
+	s ^= s >> 33;
+
+	if (!s) s = 1;
+
+	for (int i = 0; i < CHUNKSIZE*CHUNKSIZE; ++i) {
+		/* xorshift64* */
+		s ^= s >> 12;
+		s ^= s << 25;
+		s ^= s >> 27;
+		dest[i] = ((s * 0x2545f4914f6cdd1dULL) >> 32) % world_types;
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+/*
+ * world
+ *
+ * source of chunk tile data shared by all demos.
+ * chunks come from region files when a world directory is open, otherwise they are
+ * generated from a seed, so the same seed always gives the same world.
+ * stored chunks are returned straight from the mapped file, generated ones pass through a
+ * palette-compressed cache (wcache) so they aren't generated again.
+ * edited chunks are copied out on their first edit and served from memory from then on.
+ * world_query is safe to call from worker threads.
+ */
+
+void world_init(int types); /* generated tile ids are drawn from [0, types) */
+void world_seed(unsigned seed); /* call before world_init, otherwise the seed is random */
+
+int world_open(const char* dir); /* read chunks from the region files in dir */
+void world_close(void);
+
+/*
+ * returns the CHUNKSIZE*CHUNKSIZE tiles of a chunk, cx, cy: chunk numbers.
+ * stored chunks point straight into the mapped region file, generated ones are written to scratch.
+ * chunks missing from an open world are empty
+ */
+const tile_t* world_query(int cx, int cy, tile_t* scratch);
+
+/* edits, tx, ty: tile coordinates. edits are kept in memory only, region files are never written */
+void world_set_tile(int tx, int ty, tile_t id);
+void world_fill_rect(int tx, int ty, int w, int h, tile_t id);
+
+/*
+ * pops a chunk edited since it was last returned, rect gets the tiles covering all of those
+ * edits relative to the chunk (x0, y0, x1, y1, the far edges exclusive). 0 when none are left
+ */
+int world_next_dirty(int* cx, int* cy, int* rect);
+
+/*
+ * number of edited chunks, bytes gets the memory they hold. edited chunks are the only copy of
+ * their tiles, so this only grows until world_close
+ */
+unsigned world_edited(size_t* bytes);
+
+int world_generate(const char* dir, int regions, int types); /* saves regions x regions region files of generated chunks */
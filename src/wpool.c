@@ -0,0 +1,182 @@
+#include "wpool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "spsc.h"
+#include "timer.h"
+
+#define WPOOL_MAX_WORKERS 64
+
+typedef struct _wpool_worker {
+	pthread_t thread;
+	sem_t wake;
+	spsc jobs, done;
+	unsigned outstanding; /* GL thread only */
+} wpool_worker;
+
+static wpool_worker* workers;
+static int nworkers, quit;
+static wpool_fn work_fn;
+static size_t job_size;
+static wpool_job* job_free;
+static wpool_job** job_all;
+static unsigned job_count, job_cap, poll_next;
+
+static void* wpool_main(void* arg);
+
+int wpool_init(int count, size_t datasize, wpool_fn fn) {
+	if (count <= 0) {
+		count = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+		if (count < 1) count = 1;
+	}
+
+	if (count > WPOOL_MAX_WORKERS) count = WPOOL_MAX_WORKERS;
+
+	workers = calloc(count, sizeof *workers);
+	if (!workers) return 1;
+
+	work_fn = fn;
+	job_size = sizeof(wpool_job) + datasize;
+	quit = 0;
+
+	for (int i = 0; i < count; ++i) {
+		wpool_worker* w = workers + i;
+
+		if (spsc_init(&w->jobs, WPOOL_RING) || spsc_init(&w->done, WPOOL_RING) || sem_init(&w->wake, 0, 0)) {
+			printf("wpool: failed to set up worker %d\n", i);
+			return 1;
+		}
+
+		if (pthread_create(&w->thread, NULL, wpool_main, w)) {
+			printf("wpool: failed to start worker %d\n", i);
+			return 1;
+		}
+
+		nworkers++;
+	}
+
+	printf("wpool: started %d workers\n", nworkers);
+	return 0;
+}
+
+void wpool_free(void) {
+	if (!workers) return;
+
+	__atomic_store_n(&quit, 1, __ATOMIC_RELEASE);
+
+	for (int i = 0; i < nworkers; ++i) {
+		sem_post(&workers[i].wake);
+		pthread_join(workers[i].thread, NULL);
+		sem_destroy(&workers[i].wake);
+		spsc_free(&workers[i].jobs);
+		spsc_free(&workers[i].done);
+	}
+
+	/* jobs may still be sitting in rings or held by the caller, so free from the master list */
+	for (unsigned i = 0; i < job_count; ++i) free(job_all[i]);
+
+	free(job_all);
+	free(workers);
+
+	workers = NULL;
+	job_all = NULL;
+	job_free = NULL;
+	job_count = job_cap = 0;
+	nworkers = 0;
+}
+
+int wpool_submit(int cx, int cy, unsigned gen) {
+	wpool_worker* w = NULL;
+
+	for (int i = 0; i < nworkers; ++i) {
+		if (!w || workers[i].outstanding < w->outstanding) w = workers + i;
+	}
+
+	if (!w || w->outstanding >= WPOOL_RING) return 1;
+
+	wpool_job* j = job_free;
+
+	if (j) {
+		job_free = j->next;
+	} else {
+		if (job_count == job_cap) {
+			unsigned cap = job_cap ? job_cap * 2 : 64;
+			wpool_job** next = realloc(job_all, sizeof *next * cap);
+			if (!next) return 1;
+			job_all = next;
+			job_cap = cap;
+		}
+
+		j = malloc(job_size);
+		if (!j) return 1;
+		job_all[job_count++] = j;
+	}
+
+	j->cx = cx;
+	j->cy = cy;
+	j->gen = gen;
+	j->next = NULL;
+
+	/* can't fail: a worker never has more than WPOOL_RING jobs outstanding */
+	spsc_push(&w->jobs, j);
+	w->outstanding++;
+	sem_post(&w->wake);
+	return 0;
+}
+
+wpool_job* wpool_poll(void) {
+	/* round robin so one busy worker can't starve the others */
+	for (int i = 0; i < nworkers; ++i) {
+		wpool_worker* w = workers + (poll_next + i) % nworkers;
+		wpool_job* j = spsc_pop(&w->done);
+
+		if (j) {
+			w->outstanding--;
+			poll_next = (poll_next + i + 1) % nworkers;
+			return j;
+		}
+	}
+
+	return NULL;
+}
+
+void wpool_release(wpool_job* job) {
+	job->next = job_free;
+	job_free = job;
+}
+
+int wpool_workers(void) {
+	return nworkers;
+}
+
+int wpool_pending(void) {
+	int total = 0;
+	for (int i = 0; i < nworkers; ++i) total += workers[i].outstanding;
+	return total;
+}
+
+void* wpool_main(void* arg) {
+	wpool_worker* w = arg;
+
+	TIMER_THREAD("worker");
+
+	while (1) {
+		sem_wait(&w->wake);
+		if (__atomic_load_n(&quit, __ATOMIC_ACQUIRE)) break;
+
+		wpool_job* j = spsc_pop(&w->jobs);
+		if (!j) continue;
+
+		work_fn(j);
+
+		/* can't fail either, the done ring is as large as the job ring */
+		spsc_push(&w->done, j);
+	}
+
+	return NULL;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+/*
+ * wpool
+ *
+ * background worker threads that prepare chunk tile data off the GL thread.
+ * every worker is fed through its own pair of lock-free spsc rings, so the only
+ * blocking left is a semaphore for idle workers to sleep on.
+ * submit/poll/release must all be called from the same (GL) thread.
+ */
+
+#define WPOOL_RING 64 /* max jobs in flight per worker */
+
+typedef struct _wpool_job {
+	int cx, cy;
+	unsigned gen; /* the caller's stamp, handed back untouched */
+	struct _wpool_job* next; /* free list, owned by the pool */
+	const tile_t* tiles; /* set by the worker, either data or memory that outlives the job */
+	uint8_t data[]; /* datasize bytes, filled by the worker */
+} wpool_job;
+
+typedef void (*wpool_fn)(wpool_job* job); /* runs on a worker thread */
+
+int wpool_init(int workers, size_t datasize, wpool_fn fn); /* workers <= 0 picks one per spare core */
+void wpool_free(void);
+
+int wpool_submit(int cx, int cy, unsigned gen); /* nonzero if every worker is saturated */
+wpool_job* wpool_poll(void); /* next finished job or NULL */
+void wpool_release(wpool_job* job); /* hand a polled job back for reuse */
+
+int wpool_workers(void);
+int wpool_pending(void); /* jobs submitted but not polled yet */